@@ -0,0 +1,94 @@
+// Microbenchmark for keyword recognition: the previous std::unordered_map
+// lookup (two probes on a freshly built std::string) against
+// TokenManager::classifyIdentifier on keyword-dense and identifier-dense input.
+#include "../src/lexer/Tokens.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using namespace umbra;
+
+const std::vector<std::string> keywords = {
+    "int",    "float",  "bool",      "char",      "string",       "if",
+    "else",   "repeat", "times",     "func",      "return",       "new",
+    "delete", "and",    "or",        "equal",     "different",    "less_than",
+    "greater_than",     "less_or_equal",          "greater_or_equal"};
+
+// Keeps the classification results observable so the loops are not elided
+unsigned checksum = 0;
+
+const std::unordered_map<std::string, TokenType> &mapKeywords() {
+    static const std::unordered_map<std::string, TokenType> map = [] {
+        std::unordered_map<std::string, TokenType> m;
+        for (const auto &keyword : keywords)
+            m.emplace(keyword, TokenManager::classifyIdentifier(keyword));
+        return m;
+    }();
+    return map;
+}
+
+// Original Lexer::identifier() lookup
+TokenType classifyWithMap(std::string_view text) {
+    std::string spelling(text);
+    return mapKeywords().count(spelling) ? mapKeywords().at(spelling) : TokenType::TOK_IDENTIFIER;
+}
+
+std::vector<std::string> makeCorpus(size_t count, double keywordRatio) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<size_t> pickKeyword(0, keywords.size() - 1);
+    std::uniform_int_distribution<int> length(1, 24);
+    const char alphabet[] = "abcdefghijklmnopqrstuvwxyz_0123456789";
+    std::uniform_int_distribution<int> letter(0, 26); // first char: letter or '_'
+    std::uniform_int_distribution<int> any(0, sizeof(alphabet) - 2);
+
+    std::vector<std::string> corpus;
+    corpus.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (coin(rng) < keywordRatio) {
+            corpus.push_back(keywords[pickKeyword(rng)]);
+            continue;
+        }
+        std::string ident(1, alphabet[letter(rng)]);
+        for (int n = length(rng); n > 0; --n)
+            ident += alphabet[any(rng)];
+        corpus.push_back(std::move(ident));
+    }
+    return corpus;
+}
+
+template <typename Classify>
+double nsPerLookup(const std::vector<std::string> &corpus, Classify classify, int rounds) {
+    auto begin = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; ++r) {
+        for (const auto &word : corpus)
+            checksum += static_cast<unsigned>(classify(std::string_view(word)));
+    }
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+    return ns / (static_cast<double>(corpus.size()) * rounds);
+}
+
+void run(const char *name, double keywordRatio) {
+    const auto corpus = makeCorpus(1 << 16, keywordRatio);
+    const int rounds = 50;
+    double map = nsPerLookup(corpus, classifyWithMap, rounds);
+    double perfect = nsPerLookup(corpus, TokenManager::classifyIdentifier, rounds);
+    std::printf("%-18s unordered_map %7.2f ns  classifyIdentifier %7.2f ns  speedup %5.2fx\n",
+                name, map, perfect, map / perfect);
+}
+
+} // namespace
+
+int main() {
+    run("keyword-dense", 0.8);
+    run("identifier-dense", 0.1);
+    std::printf("checksum %u\n", checksum);
+    return 0;
+}
@@ -0,0 +1,535 @@
+// Throughput suite for the front end. Lexes and parses synthetic corpora of
+// several sizes and token mixes and reports MB/s, tokens/s, nodes/s and heap
+// allocations per token. Results can be written as JSON and compared against a
+// stored baseline:
+//
+//   umbra_bench --json=current.json --baseline=bench/baseline.json
+//
+// exits with status 1 if any case is slower, or allocates more, than the
+// baseline by more than --tolerance. Build with CMAKE_BUILD_TYPE=Release; the
+// stored baseline was recorded that way with --max-size-mb=16, and cases
+// missing from either side are not compared.
+#include "../src/ast/ASTDumper.h"
+#include "../src/ast/ASTSerialization.h"
+#include "../src/ast/FlatAST.h"
+#include "../src/ast/visitor/ASTVisitor.h"
+#include "../src/ast/visitor/RecursiveASTVisitor.h"
+#include "../src/error/ErrorManager.h"
+#include "../src/lexer/Lexer.h"
+#include "../src/lexer/TokenPipeline.h"
+#include "../src/parser/Parser.h"
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/FormatVariadic.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Allocation counting: every global operator new in the process goes through here */
+
+namespace {
+std::atomic<uint64_t> allocationCount{0};
+} // namespace
+
+void *operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+using namespace umbra;
+
+llvm::cl::opt<std::string> jsonOutput("json", llvm::cl::desc("Write the results as JSON to <file>"),
+                                      llvm::cl::value_desc("file"));
+llvm::cl::opt<std::string> baselineFile("baseline",
+                                        llvm::cl::desc("Compare against a JSON baseline"),
+                                        llvm::cl::value_desc("file"));
+llvm::cl::opt<double>
+    tolerance("tolerance", llvm::cl::desc("Allowed regression against the baseline (0.15 = 15%)"),
+              llvm::cl::init(0.15));
+llvm::cl::opt<unsigned> maxSizeMB("max-size-mb", llvm::cl::desc("Largest corpus to run, in MB"),
+                                  llvm::cl::init(100));
+llvm::cl::opt<double> minTime("min-time",
+                              llvm::cl::desc("Minimum seconds spent on each case (best run wins)"),
+                              llvm::cl::init(0.5));
+llvm::cl::opt<std::string> filter("filter",
+                                  llvm::cl::desc("Only run cases whose name contains <text>"),
+                                  llvm::cl::value_desc("text"));
+
+/* Corpora. Every line is a declaration the parser accepts without diagnostics,
+   so the numbers measure the happy path. */
+
+enum class Mix { Keywords, Identifiers, Literals, Utf8Literals, Newlines };
+
+const char *mixName(Mix mix) {
+    switch (mix) {
+    case Mix::Keywords:
+        return "keywords";
+    case Mix::Identifiers:
+        return "identifiers";
+    case Mix::Literals:
+        return "literals";
+    case Mix::Utf8Literals:
+        return "utf8";
+    case Mix::Newlines:
+        return "newlines";
+    }
+    return "?";
+}
+
+std::string randomIdentifier(std::mt19937 &rng, int minLength, int maxLength) {
+    static const char alphabet[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+    std::uniform_int_distribution<int> length(minLength, maxLength);
+    std::uniform_int_distribution<int> first(0, 52); // letters and '_'
+    std::uniform_int_distribution<int> any(0, sizeof(alphabet) - 2);
+    std::string id;
+    do {
+        id.assign(1, alphabet[first(rng)]);
+        for (int i = length(rng); i > 1; --i)
+            id += alphabet[any(rng)];
+    } while (TokenManager::classifyIdentifier(id) != TokenType::TOK_IDENTIFIER);
+    return id;
+}
+
+std::string makeLine(Mix mix, std::mt19937 &rng) {
+    std::uniform_int_distribution<int> pick(0, 3);
+    switch (mix) {
+    case Mix::Keywords: {
+        static const char *lines[] = {"int i = 1\n", "bool flag\n", "char c\n",
+                                      "string s\n",  "float f = 2\n", "int[8] v\n",
+                                      "bool done\n", "float[4] m\n"};
+        return lines[std::uniform_int_distribution<size_t>(0, std::size(lines) - 1)(rng)];
+    }
+    case Mix::Identifiers:
+        if (pick(rng) == 0)
+            return "float[" + randomIdentifier(rng, 4, 16) + "] " + randomIdentifier(rng, 6, 24) +
+                   "\n";
+        return "int " + randomIdentifier(rng, 6, 24) + "\n";
+    case Mix::Literals:
+        switch (pick(rng)) {
+        case 0:
+            return "int n = " + std::to_string(rng() % 100000000) + "\n";
+        case 1:
+            return "float x = " + std::to_string(rng() % 100000) + "." +
+                   std::to_string(rng() % 1000000) + "\n";
+        default: {
+            std::string text = randomIdentifier(rng, 10, 60);
+            std::replace(text.begin(), text.end(), '_', ' ');
+            return "string s = \"" + text + "\"\n";
+        }
+        }
+    case Mix::Utf8Literals: {
+        // Same shape as the ASCII string literals, in Spanish and CJK text
+        static const char *words[] = {"canción", "señor", "niño", "pingüino", "año",
+                                      "漢字",    "日本語", "文字列", "¡hola!",  "¿qué?"};
+        std::string text;
+        for (int i = 1 + rng() % 8; i > 0; --i)
+            text += std::string(words[rng() % std::size(words)]) + " ";
+        return "string s = \"" + text + "\"\n";
+    }
+    case Mix::Newlines:
+        // Runs of '\n' collapse into a single newline token
+        return "int a = 1" + std::string(1 + rng() % 16, '\n');
+    }
+    return "\n";
+}
+
+std::string makeCorpus(Mix mix, size_t size) {
+    std::mt19937 rng(1234);
+    std::string corpus;
+    corpus.reserve(size + 128);
+    while (corpus.size() < size)
+        corpus += makeLine(mix, rng);
+    return corpus;
+}
+
+/* Measurements */
+
+// Counts every node reachable from the root
+class NodeCounter : public ASTVisitor {
+  public:
+    size_t count = 0;
+
+    void visit(ProgramNode &node) override {
+        count++;
+        for (const auto &statement : node.getStatements())
+            if (statement)
+                statement->accept(*this);
+    }
+    void visit(st_VariableDeclNode &node) override {
+        count++;
+        if (node.getInitializer())
+            node.getInitializer()->accept(*this);
+        if (node.getArraySize())
+            node.getArraySize()->accept(*this);
+    }
+    void visit(ParameterNode &) override { count++; }
+    void visit(ReturnStatementNode &node) override {
+        count++;
+        if (node.getReturnValue())
+            node.getReturnValue()->accept(*this);
+    }
+    void visit(FunctionDeclNode &node) override {
+        count++;
+        for (ParameterNode *parameter : node.getParams())
+            parameter->accept(*this);
+        for (ASTNode *statement : node.getBody())
+            if (statement)
+                statement->accept(*this);
+        if (node.getReturnStmt())
+            node.getReturnStmt()->accept(*this);
+    }
+    void visit(ex_IntegerLiteralNode &) override { count++; }
+    void visit(ex_FloatLiteralNode &) override { count++; }
+    void visit(ex_StringLiteralNode &) override { count++; }
+    void visit(ex_CharLiteralNode &) override { count++; }
+    void visit(ex_BoolLiteralNode &) override { count++; }
+    void visit(ex_IdentifierNode &) override { count++; }
+};
+
+// NodeCounter written against the static visitor
+class StaticNodeCounter : public RecursiveASTVisitor<StaticNodeCounter> {
+  public:
+    size_t count = 0;
+
+    bool visitNode(ASTNode *) {
+        count++;
+        return true;
+    }
+};
+
+struct Result {
+    std::string name;
+    size_t bytes = 0;
+    size_t tokens = 0;
+    size_t nodes = 0;
+    double seconds = 0; // best run
+    uint64_t allocations = 0;
+
+    double mbPerSecond() const { return bytes / seconds / 1e6; }
+    double tokensPerSecond() const { return tokens / seconds; }
+    double nodesPerSecond() const { return nodes / seconds; }
+    double allocationsPerToken() const { return tokens ? double(allocations) / tokens : 0.0; }
+};
+
+// Runs `body` until minTime has elapsed (at least once) and keeps the fastest
+// run; allocations are taken from the first run.
+template <typename Body> void measure(Result &result, Body body) {
+    using Clock = std::chrono::steady_clock;
+    double spent = 0;
+    result.seconds = 1e30;
+    for (int run = 0; run == 0 || spent < minTime; ++run) {
+        uint64_t before = allocationCount.load(std::memory_order_relaxed);
+        auto begin = Clock::now();
+        body();
+        double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+        if (run == 0)
+            result.allocations = allocationCount.load(std::memory_order_relaxed) - before;
+        result.seconds = std::min(result.seconds, seconds);
+        spent += seconds;
+    }
+}
+
+void runCase(Mix mix, size_t size, const char *sizeName, std::vector<Result> &results) {
+    std::string prefix = std::string(mixName(mix)) + "/" + sizeName;
+    if (!filter.empty() && prefix.find(filter) == std::string::npos)
+        return;
+
+    SourceBuffer source(makeCorpus(mix, size));
+    size_t tokenCount = 0;
+
+    Result lex;
+    lex.name = "lex/" + prefix;
+    lex.bytes = source.size();
+    measure(lex, [&] {
+        ErrorManager errors;
+        Lexer lexer(source, errors);
+        TokenBuffer tokens = lexer.tokenize();
+        tokenCount = tokens.size();
+    });
+    lex.tokens = tokenCount;
+    results.push_back(lex);
+
+    ErrorManager errors;
+    Lexer lexer(source, errors);
+    TokenBuffer tokens = lexer.tokenize();
+
+    Result parse;
+    parse.name = "parse/" + prefix;
+    parse.bytes = source.size();
+    parse.tokens = tokens.size();
+    measure(parse, [&] {
+        ErrorManager parseErrors;
+        Parser parser(tokens, parseErrors);
+        ASTContext context;
+        ProgramNode *ast = parser.parse(context);
+        NodeCounter counter;
+        ast->accept(counter);
+        parse.nodes = counter.count;
+    });
+    results.push_back(parse);
+
+    // The same with equal literals and identifiers hash-consed
+    Result uniqueParse;
+    uniqueParse.name = "parse-unique/" + prefix;
+    uniqueParse.bytes = source.size();
+    uniqueParse.tokens = tokens.size();
+    uniqueParse.nodes = parse.nodes;
+    measure(uniqueParse, [&] {
+        ErrorManager parseErrors;
+        Parser parser(tokens, parseErrors);
+        ASTContext context;
+        context.setUniquing(true);
+        parser.parse(context);
+    });
+    results.push_back(uniqueParse);
+
+    // Lex + parse end to end with the two stages overlapped on two threads;
+    // on a multi-core machine this approaches the slower of lex/ and parse/
+    Result pipelined;
+    pipelined.name = "pipeline/" + prefix;
+    pipelined.bytes = source.size();
+    pipelined.tokens = tokens.size();
+    pipelined.nodes = parse.nodes;
+    measure(pipelined, [&] {
+        ErrorManager pipelineErrors;
+        Lexer pipelineLexer(source, pipelineErrors);
+        TokenPipeline pipeline(pipelineLexer);
+        Parser parser(pipeline, pipelineErrors);
+        ASTContext context;
+        parser.parse(context);
+    });
+    results.push_back(pipelined);
+
+    // The same whole-tree scan with virtual double dispatch (ASTVisitor), with
+    // static dispatch (RecursiveASTVisitor) and over the flat copy. The 16MB
+    // corpora hold about a million nodes.
+    ErrorManager treeErrors;
+    ASTContext context;
+    ProgramNode *program = Parser(tokens, treeErrors).parse(context);
+    FlatAST flat = FlatAST::build(*program, source);
+
+    Result walk;
+    walk.name = "walk/" + prefix;
+    walk.bytes = source.size();
+    walk.tokens = tokens.size();
+    measure(walk, [&] {
+        NodeCounter counter;
+        program->accept(counter);
+        walk.nodes = counter.count;
+    });
+    results.push_back(walk);
+
+    Result staticWalk;
+    staticWalk.name = "static-walk/" + prefix;
+    staticWalk.bytes = source.size();
+    staticWalk.tokens = tokens.size();
+    measure(staticWalk, [&] {
+        StaticNodeCounter counter;
+        counter.traverse(program);
+        staticWalk.nodes = counter.count;
+    });
+    results.push_back(staticWalk);
+
+    Result flatWalk;
+    flatWalk.name = "flat-walk/" + prefix;
+    flatWalk.bytes = source.size();
+    flatWalk.tokens = tokens.size();
+    measure(flatWalk, [&] {
+        size_t perKind[static_cast<size_t>(FlatKind::FunctionDecl) + 1] = {};
+        for (const FlatNode &node : flat.getNodes())
+            perKind[static_cast<size_t>(node.kind)]++;
+        flatWalk.nodes = std::accumulate(std::begin(perKind), std::end(perKind), size_t(0));
+    });
+    results.push_back(flatWalk);
+
+    // Writing the tree as a .umbast module, and loading it back instead of
+    // lexing and parsing the source (compare with parse/)
+    std::string module;
+    Result moduleWrite;
+    moduleWrite.name = "module-write/" + prefix;
+    moduleWrite.bytes = source.size();
+    moduleWrite.tokens = tokens.size();
+    moduleWrite.nodes = walk.nodes;
+    measure(moduleWrite, [&] { module = ASTWriter::serialize(*program, source); });
+    results.push_back(moduleWrite);
+
+    Result moduleLoad;
+    moduleLoad.name = "module-load/" + prefix;
+    moduleLoad.bytes = source.size();
+    moduleLoad.tokens = tokens.size();
+    measure(moduleLoad, [&] {
+        ASTContext moduleContext;
+        auto reader = ASTReader::create(
+            llvm::MemoryBuffer::getMemBuffer(module, "bench.umbast", false), moduleContext);
+        StaticNodeCounter counter;
+        counter.traverse(reader->getProgram());
+        moduleLoad.nodes = counter.count;
+    });
+    results.push_back(moduleLoad);
+
+    // Dumping the tree into a buffered sink that discards the bytes, so only
+    // formatting is measured: PrintVisitor against each ASTDumper format
+    std::pair<const char *, std::function<void(llvm::raw_ostream &)>> dumps[] = {
+        {"dump-print/", [&](llvm::raw_ostream &os) {
+             PrintVisitor printer(os);
+             program->accept(printer);
+         }},
+        {"dump-text/", [&](llvm::raw_ostream &os) {
+             ASTDumper(os, ASTDumper::Format::Text).dump(program);
+         }},
+        {"dump-json/", [&](llvm::raw_ostream &os) {
+             ASTDumper(os, ASTDumper::Format::JSON).dump(program);
+         }},
+        {"dump-dot/", [&](llvm::raw_ostream &os) {
+             ASTDumper(os, ASTDumper::Format::DOT).dump(program);
+         }},
+    };
+    for (auto &[name, body] : dumps) {
+        Result dump;
+        dump.name = name + prefix;
+        dump.bytes = source.size();
+        dump.tokens = tokens.size();
+        dump.nodes = walk.nodes;
+        measure(dump, [&] {
+            llvm::raw_null_ostream os;
+            body(os);
+        });
+        results.push_back(dump);
+    }
+}
+
+/* Reporting */
+
+llvm::json::Value toJSON(const std::vector<Result> &results) {
+    llvm::json::Array benchmarks;
+    for (const auto &r : results) {
+        benchmarks.push_back(llvm::json::Object{
+            {"name", r.name},
+            {"bytes", static_cast<int64_t>(r.bytes)},
+            {"tokens", static_cast<int64_t>(r.tokens)},
+            {"nodes", static_cast<int64_t>(r.nodes)},
+            {"seconds", r.seconds},
+            {"mb_per_s", r.mbPerSecond()},
+            {"tokens_per_s", r.tokensPerSecond()},
+            {"nodes_per_s", r.nodesPerSecond()},
+            {"allocs_per_token", r.allocationsPerToken()},
+        });
+    }
+    return llvm::json::Object{{"benchmarks", std::move(benchmarks)}};
+}
+
+// Prints every case that regressed and returns how many did
+int compareWithBaseline(const std::vector<Result> &results) {
+    auto file = llvm::MemoryBuffer::getFile(baselineFile);
+    if (!file) {
+        llvm::errs() << "Unable to open baseline: " << baselineFile << "\n";
+        return 1;
+    }
+    llvm::Expected<llvm::json::Value> parsed = llvm::json::parse((*file)->getBuffer());
+    if (!parsed) {
+        llvm::errs() << "Invalid baseline: " << llvm::toString(parsed.takeError()) << "\n";
+        return 1;
+    }
+    const llvm::json::Array *entries =
+        parsed->getAsObject() ? parsed->getAsObject()->getArray("benchmarks") : nullptr;
+    if (!entries) {
+        llvm::errs() << "Invalid baseline: missing \"benchmarks\"\n";
+        return 1;
+    }
+
+    int regressions = 0;
+    for (const auto &entry : *entries) {
+        const llvm::json::Object *base = entry.getAsObject();
+        if (!base)
+            continue;
+        auto name = base->getString("name");
+        auto it = std::find_if(results.begin(), results.end(),
+                               [&](const Result &r) { return name && r.name == *name; });
+        if (it == results.end())
+            continue;
+
+        double baseSpeed = base->getNumber("mb_per_s").getValueOr(0);
+        double baseAllocs = base->getNumber("allocs_per_token").getValueOr(0);
+        if (it->mbPerSecond() < baseSpeed * (1 - tolerance)) {
+            std::printf("REGRESSION %-32s %9.1f MB/s (baseline %.1f)\n", it->name.c_str(),
+                        it->mbPerSecond(), baseSpeed);
+            regressions++;
+        }
+        if (it->allocationsPerToken() > baseAllocs * (1 + tolerance) + 1e-9) {
+            std::printf("REGRESSION %-32s %9.3f allocs/token (baseline %.3f)\n", it->name.c_str(),
+                        it->allocationsPerToken(), baseAllocs);
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Umbra lexer/parser benchmarks\n");
+
+    struct Size {
+        size_t bytes;
+        const char *name;
+    };
+    const Size sizes[] = {{1 << 10, "1KB"},
+                          {64 << 10, "64KB"},
+                          {1 << 20, "1MB"},
+                          {16 << 20, "16MB"},
+                          {100 << 20, "100MB"}};
+    const Mix mixes[] = {Mix::Keywords, Mix::Identifiers, Mix::Literals, Mix::Utf8Literals,
+                         Mix::Newlines};
+
+    std::vector<Result> results;
+    std::printf("%-32s %10s %12s %12s %13s\n", "case", "MB/s", "tokens/s", "nodes/s",
+                "allocs/token");
+    for (const Size &size : sizes) {
+        if (size.bytes > (size_t(maxSizeMB) << 20))
+            break;
+        for (Mix mix : mixes) {
+            size_t first = results.size();
+            runCase(mix, size.bytes, size.name, results);
+            for (size_t i = first; i < results.size(); ++i) {
+                const Result &r = results[i];
+                std::printf("%-32s %10.1f %12.3g %12.3g %13.3f\n", r.name.c_str(), r.mbPerSecond(),
+                            r.tokensPerSecond(), r.nodesPerSecond(), r.allocationsPerToken());
+            }
+        }
+    }
+
+    if (!jsonOutput.empty()) {
+        std::error_code error;
+        llvm::raw_fd_ostream out(jsonOutput, error);
+        if (error) {
+            llvm::errs() << "Unable to write " << jsonOutput << ": " << error.message() << "\n";
+            return 1;
+        }
+        out << llvm::formatv("{0:2}", toJSON(results)) << "\n";
+    }
+
+    if (!baselineFile.empty() && compareWithBaseline(results) > 0)
+        return 1;
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef AST_CODES_H
+#define AST_CODES_H
+
+#include "../lexer/Tokens.h"
+#include "../support/StableCodes.h"
+#include "ASTNode.h"
+
+namespace umbra {
+
+// Fixed codes for node kinds and declared types, independent of the order of
+// ASTNode::Kind and TokenType. Anything that outlives a build uses them: the
+// .umbast format and structuralHash(). Append only; changing an existing
+// entry needs a new .umbast version and changes every stored hash.
+namespace astcodes {
+
+inline constexpr ASTNode::Kind KIND_TABLE[] = {
+    ASTNode::Kind::Program,         ASTNode::Kind::Parameter,
+    ASTNode::Kind::VariableDecl,    ASTNode::Kind::ReturnStatement,
+    ASTNode::Kind::FunctionDecl,    ASTNode::Kind::IntegerLiteral,
+    ASTNode::Kind::FloatLiteral,    ASTNode::Kind::StringLiteral,
+    ASTNode::Kind::CharLiteral,     ASTNode::Kind::BoolLiteral,
+    ASTNode::Kind::Identifier};
+inline constexpr StableCodes<ASTNode::Kind, sizeof(KIND_TABLE) / sizeof(KIND_TABLE[0])> KINDS(
+    KIND_TABLE);
+static_assert(KINDS.covers(static_cast<size_t>(ASTNode::Kind::LastExpression) + 1),
+              "every ASTNode::Kind needs exactly one code");
+
+// Only type specifiers can be declared
+inline constexpr TokenType TYPE_TABLE[] = {TokenType::TOK_INT, TokenType::TOK_FLOAT,
+                                           TokenType::TOK_BOOL, TokenType::TOK_CHAR,
+                                           TokenType::TOK_STRING};
+inline constexpr StableCodes<TokenType, sizeof(TYPE_TABLE) / sizeof(TYPE_TABLE[0])> TYPES(
+    TYPE_TABLE);
+
+} // namespace astcodes
+
+} // namespace umbra
+
+#endif // AST_CODES_H
@@ -0,0 +1,51 @@
+#include "ASTContext.h"
+#include <llvm/ADT/Hashing.h>
+#include <llvm/Support/Casting.h>
+#include <cstring>
+
+namespace umbra {
+
+unsigned ASTContext::LeafKeyInfo::getHashValue(const LeafKey &key) {
+    return static_cast<unsigned>(
+        llvm::hash_combine(static_cast<uint8_t>(key.kind), key.bits, key.text));
+}
+
+template <typename T, typename Value> T *ASTContext::getLeaf(LeafKey key, Value value) {
+    if (!uniquing)
+        return create<T>(value);
+    auto inserted = leaves.try_emplace(key, nullptr);
+    if (inserted.second)
+        inserted.first->second = create<T>(value);
+    return llvm::cast<T>(inserted.first->second);
+}
+
+ex_IntegerLiteralNode *ASTContext::getIntegerLiteral(int64_t value) {
+    return getLeaf<ex_IntegerLiteralNode>(
+        {ASTNode::Kind::IntegerLiteral, static_cast<uint64_t>(value), {}}, value);
+}
+
+ex_FloatLiteralNode *ASTContext::getFloatLiteral(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return getLeaf<ex_FloatLiteralNode>({ASTNode::Kind::FloatLiteral, bits, {}}, value);
+}
+
+ex_StringLiteralNode *ASTContext::getStringLiteral(std::string_view value) {
+    return getLeaf<ex_StringLiteralNode>(
+        {ASTNode::Kind::StringLiteral, 0, {value.data(), value.size()}}, value);
+}
+
+ex_CharLiteralNode *ASTContext::getCharLiteral(std::string_view value) {
+    return getLeaf<ex_CharLiteralNode>(
+        {ASTNode::Kind::CharLiteral, 0, {value.data(), value.size()}}, value);
+}
+
+ex_BoolLiteralNode *ASTContext::getBoolLiteral(bool value) {
+    return getLeaf<ex_BoolLiteralNode>({ASTNode::Kind::BoolLiteral, value, {}}, value);
+}
+
+ex_IdentifierNode *ASTContext::getIdentifier(Symbol name) {
+    return getLeaf<ex_IdentifierNode>({ASTNode::Kind::Identifier, name.getId(), {}}, name);
+}
+
+} // namespace umbra
@@ -0,0 +1,87 @@
+#ifndef AST_CONTEXT_H
+#define AST_CONTEXT_H
+
+#include "expressionnodes/ExpressionNode.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Allocator.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace umbra {
+
+// Owns the memory of an AST. Nodes and their child arrays are bump-allocated
+// from one arena: creating a node is a pointer increment, siblings end up next
+// to each other, and the whole tree is released at once when the context is
+// destroyed. Node destructors never run, so nodes must not own resources;
+// they refer to each other with plain pointers and ArrayRefs into the arena.
+class ASTContext {
+  public:
+    ASTContext() = default;
+    ASTContext(const ASTContext &) = delete;
+    ASTContext &operator=(const ASTContext &) = delete;
+
+    template <typename T, typename... Args> T *create(Args &&...args) {
+        void *memory = allocator.Allocate(sizeof(T), alignof(T));
+        return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    // Copies `values` (e.g. a SmallVector built while parsing) into the arena
+    template <typename T> llvm::ArrayRef<T> copyArray(llvm::ArrayRef<T> values) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "arena arrays are never destroyed");
+        if (values.empty())
+            return {};
+        T *memory = allocator.Allocate<T>(values.size());
+        std::uninitialized_copy(values.begin(), values.end(), memory);
+        return {memory, values.size()};
+    }
+
+    // Factories for leaf expressions. With uniquing on, every call with the
+    // same value returns the same node (hash-consing): a literal or name that
+    // is used a thousand times is allocated once, and equal leaves can be
+    // compared by address. Values are compared bit for bit, so 0.0 and -0.0
+    // stay distinct. Off by default, in which case these are plain create().
+    void setUniquing(bool enabled) { uniquing = enabled; }
+    bool isUniquing() const { return uniquing; }
+
+    ex_IntegerLiteralNode *getIntegerLiteral(int64_t value);
+    ex_FloatLiteralNode *getFloatLiteral(double value);
+    ex_StringLiteralNode *getStringLiteral(std::string_view value);
+    ex_CharLiteralNode *getCharLiteral(std::string_view value);
+    ex_BoolLiteralNode *getBoolLiteral(bool value);
+    ex_IdentifierNode *getIdentifier(Symbol name);
+
+    size_t getBytesAllocated() const { return allocator.getBytesAllocated(); }
+
+  private:
+    // A leaf's kind and value; text points into the node that was created
+    struct LeafKey {
+        ASTNode::Kind kind;
+        uint64_t bits;
+        llvm::StringRef text;
+    };
+    struct LeafKeyInfo {
+        static LeafKey getEmptyKey() { return {ASTNode::Kind::Program, 0, {}}; }
+        static LeafKey getTombstoneKey() { return {ASTNode::Kind::Program, 1, {}}; }
+        static unsigned getHashValue(const LeafKey &key);
+        static bool isEqual(const LeafKey &a, const LeafKey &b) {
+            return a.kind == b.kind && a.bits == b.bits && a.text == b.text;
+        }
+    };
+
+    template <typename T, typename Value> T *getLeaf(LeafKey key, Value value);
+
+    llvm::BumpPtrAllocator allocator;
+    bool uniquing = false;
+    llvm::DenseMap<LeafKey, ExpressionNode *, LeafKeyInfo> leaves;
+};
+
+} // namespace umbra
+
+#endif // AST_CONTEXT_H
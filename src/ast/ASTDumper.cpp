@@ -0,0 +1,337 @@
+#include "ASTDumper.h"
+#include "ProgramNode.h"
+#include "expressionnodes/ExpressionNode.h"
+#include "statementnodes/StatementNode.h"
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/Format.h>
+#include <llvm/Support/JSON.h>
+
+namespace umbra {
+
+namespace {
+
+llvm::StringRef nodeName(ASTNode::Kind kind) {
+    switch (kind) {
+    case ASTNode::Kind::Program:
+        return "Program";
+    case ASTNode::Kind::Parameter:
+        return "Parameter";
+    case ASTNode::Kind::VariableDecl:
+        return "VariableDeclaration";
+    case ASTNode::Kind::ReturnStatement:
+        return "ReturnStatement";
+    case ASTNode::Kind::FunctionDecl:
+        return "FunctionDeclaration";
+    case ASTNode::Kind::IntegerLiteral:
+        return "IntegerLiteral";
+    case ASTNode::Kind::FloatLiteral:
+        return "FloatLiteral";
+    case ASTNode::Kind::StringLiteral:
+        return "StringLiteral";
+    case ASTNode::Kind::CharLiteral:
+        return "CharLiteral";
+    case ASTNode::Kind::BoolLiteral:
+        return "BooleanLiteral";
+    case ASTNode::Kind::Identifier:
+        return "Identifier";
+    }
+    return "Unknown";
+}
+
+// Spelling of a type specifier; unlike TokenManager::tokenTypeToString it
+// does not build a std::string per call
+llvm::StringRef typeName(TokenType type) {
+    switch (type) {
+    case TokenType::TOK_INT:
+        return "int";
+    case TokenType::TOK_FLOAT:
+        return "float";
+    case TokenType::TOK_BOOL:
+        return "bool";
+    case TokenType::TOK_CHAR:
+        return "char";
+    case TokenType::TOK_STRING:
+        return "string";
+    default:
+        return "unknown";
+    }
+}
+
+llvm::StringRef toStringRef(std::string_view text) { return {text.data(), text.size()}; }
+
+// Calls `callback(field, child)` for every non-null child, in source order
+template <typename Callback> void forEachChild(ASTNode *node, Callback callback) {
+    auto visit = [&](llvm::StringRef field, ASTNode *child) {
+        if (child)
+            callback(field, child);
+    };
+    switch (node->getKind()) {
+    case ASTNode::Kind::Program:
+        for (ASTNode *statement : llvm::cast<ProgramNode>(node)->getStatements())
+            visit("", statement);
+        break;
+    case ASTNode::Kind::VariableDecl: {
+        auto *declaration = llvm::cast<st_VariableDeclNode>(node);
+        visit("arraySize", declaration->getArraySize());
+        visit("initializer", declaration->getInitializer());
+        break;
+    }
+    case ASTNode::Kind::ReturnStatement:
+        visit("value", llvm::cast<ReturnStatementNode>(node)->getReturnValue());
+        break;
+    case ASTNode::Kind::FunctionDecl: {
+        auto *function = llvm::cast<FunctionDeclNode>(node);
+        for (ParameterNode *parameter : function->getParams())
+            visit("parameter", parameter);
+        for (ASTNode *statement : function->getBody())
+            visit("body", statement);
+        visit("return", function->getReturnStmt());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Strings from the source are not guaranteed to be UTF-8, which JSON requires
+void stringAttribute(llvm::json::OStream &json, llvm::StringRef key, std::string_view text) {
+    llvm::StringRef value = toStringRef(text);
+    if (LLVM_LIKELY(llvm::json::isUTF8(value)))
+        json.attribute(key, value);
+    else
+        json.attribute(key, llvm::json::fixUTF8(value));
+}
+
+// Writes a literal's text between `quote`s, with that quote, backslashes and
+// control characters escaped. Valid UTF-8 is passed through as is, where
+// write_escaped would octal-escape every byte of it; in text that is not
+// UTF-8 the high bytes are escaped too.
+void writeQuoted(llvm::raw_ostream &out, std::string_view text, char quote) {
+    llvm::StringRef value = toStringRef(text);
+    bool utf8 = llvm::json::isUTF8(value);
+    out << quote;
+    for (unsigned char c : value) {
+        switch (c) {
+        case '\\':
+            out << "\\\\";
+            break;
+        case '\n':
+            out << "\\n";
+            break;
+        case '\t':
+            out << "\\t";
+            break;
+        case '\r':
+            out << "\\r";
+            break;
+        default:
+            if (c == quote)
+                out << '\\' << c;
+            else if (c < 0x20 || c == 0x7f || (c >= 0x80 && !utf8))
+                out << "\\x" << llvm::format_hex_no_prefix(c, 2);
+            else
+                out << c;
+            break;
+        }
+    }
+    out << quote;
+}
+
+} // namespace
+
+void ASTDumper::dump(ASTNode *root) {
+    if (!root)
+        return;
+    switch (format) {
+    case Format::Text:
+        dumpText(root, "", 0);
+        break;
+    case Format::JSON: {
+        llvm::json::OStream json(os, 2);
+        dumpJSON(json, root);
+        os << '\n';
+        break;
+    }
+    case Format::DOT:
+        nextId = 0;
+        os << "digraph UmbraAST {\n"
+              "    rankdir = LR;\n"
+              "    node [shape = box; style = filled; fontname = \"Arial\";];\n"
+              "    edge [fontname = \"Arial\"; fontsize = 10;];\n"
+              "\n";
+        dumpDOT(root);
+        os << "}\n";
+        break;
+    }
+}
+
+void ASTDumper::writeSummary(llvm::raw_ostream &out, ASTNode *node) {
+    out << nodeName(node->getKind());
+    switch (node->getKind()) {
+    case ASTNode::Kind::Parameter: {
+        auto *parameter = llvm::cast<ParameterNode>(node);
+        out << ' ' << typeName(parameter->getType()) << ' ' << parameter->getName();
+        break;
+    }
+    case ASTNode::Kind::VariableDecl: {
+        auto *declaration = llvm::cast<st_VariableDeclNode>(node);
+        out << ' ' << typeName(declaration->getType());
+        if (declaration->getArraySize())
+            out << "[]";
+        out << ' ' << declaration->getName();
+        break;
+    }
+    case ASTNode::Kind::FunctionDecl: {
+        auto *function = llvm::cast<FunctionDeclNode>(node);
+        out << ' ' << function->getName() << " -> " << typeName(function->getReturnType());
+        break;
+    }
+    case ASTNode::Kind::IntegerLiteral:
+        out << ' ' << llvm::cast<ex_IntegerLiteralNode>(node)->value;
+        break;
+    case ASTNode::Kind::FloatLiteral:
+        out << ' ' << llvm::format("%g", llvm::cast<ex_FloatLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::StringLiteral:
+        out << ' ';
+        writeQuoted(out, llvm::cast<ex_StringLiteralNode>(node)->value, '"');
+        break;
+    case ASTNode::Kind::CharLiteral:
+        out << ' ';
+        writeQuoted(out, llvm::cast<ex_CharLiteralNode>(node)->value, '\'');
+        break;
+    case ASTNode::Kind::BoolLiteral:
+        out << (llvm::cast<ex_BoolLiteralNode>(node)->value ? " true" : " false");
+        break;
+    case ASTNode::Kind::Identifier:
+        out << ' ' << llvm::cast<ex_IdentifierNode>(node)->name;
+        break;
+    default:
+        break;
+    }
+}
+
+/* Text */
+
+void ASTDumper::dumpText(ASTNode *node, llvm::StringRef field, unsigned depth) {
+    os.indent(depth * 4);
+    if (!field.empty())
+        os << field << ": ";
+    writeSummary(os, node);
+    os << '\n';
+    forEachChild(node, [&](llvm::StringRef childField, ASTNode *child) {
+        dumpText(child, childField, depth + 1);
+    });
+}
+
+/* JSON */
+
+void ASTDumper::dumpJSON(llvm::json::OStream &json, ASTNode *node) {
+    if (!node) {
+        json.value(nullptr);
+        return;
+    }
+    auto child = [&](llvm::StringRef key, ASTNode *value) {
+        if (!value)
+            return;
+        json.attributeBegin(key);
+        dumpJSON(json, value);
+        json.attributeEnd();
+    };
+
+    json.objectBegin();
+    json.attribute("kind", nodeName(node->getKind()));
+    switch (node->getKind()) {
+    case ASTNode::Kind::Program:
+        json.attributeArray("statements", [&] {
+            for (ASTNode *statement : llvm::cast<ProgramNode>(node)->getStatements())
+                dumpJSON(json, statement);
+        });
+        break;
+    case ASTNode::Kind::Parameter: {
+        auto *parameter = llvm::cast<ParameterNode>(node);
+        json.attribute("type", typeName(parameter->getType()));
+        stringAttribute(json, "name", parameter->getName().str());
+        break;
+    }
+    case ASTNode::Kind::VariableDecl: {
+        auto *declaration = llvm::cast<st_VariableDeclNode>(node);
+        json.attribute("type", typeName(declaration->getType()));
+        stringAttribute(json, "name", declaration->getName().str());
+        child("arraySize", declaration->getArraySize());
+        child("initializer", declaration->getInitializer());
+        break;
+    }
+    case ASTNode::Kind::ReturnStatement:
+        child("value", llvm::cast<ReturnStatementNode>(node)->getReturnValue());
+        break;
+    case ASTNode::Kind::FunctionDecl: {
+        auto *function = llvm::cast<FunctionDeclNode>(node);
+        stringAttribute(json, "name", function->getName().str());
+        json.attribute("returnType", typeName(function->getReturnType()));
+        json.attributeArray("parameters", [&] {
+            for (ParameterNode *parameter : function->getParams())
+                dumpJSON(json, parameter);
+        });
+        json.attributeArray("body", [&] {
+            for (ASTNode *statement : function->getBody())
+                dumpJSON(json, statement);
+        });
+        child("return", function->getReturnStmt());
+        break;
+    }
+    case ASTNode::Kind::IntegerLiteral:
+        json.attribute("value", llvm::cast<ex_IntegerLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::FloatLiteral:
+        json.attribute("value", llvm::cast<ex_FloatLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::StringLiteral:
+        stringAttribute(json, "value", llvm::cast<ex_StringLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::CharLiteral:
+        stringAttribute(json, "value", llvm::cast<ex_CharLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::BoolLiteral:
+        json.attribute("value", llvm::cast<ex_BoolLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::Identifier:
+        stringAttribute(json, "name", llvm::cast<ex_IdentifierNode>(node)->name.str());
+        break;
+    }
+    json.objectEnd();
+}
+
+/* DOT */
+
+// Emits the node, then each child followed by the edge to it; returns the
+// node's id
+unsigned ASTDumper::dumpDOT(ASTNode *node) {
+    unsigned id = nextId++;
+
+    label.clear();
+    llvm::raw_svector_ostream labelStream(label);
+    writeSummary(labelStream, node);
+
+    os << "    n" << id << " [label = \"";
+    llvm::StringRef rest = label;
+    for (size_t quote; (quote = rest.find_first_of("\"\\")) != llvm::StringRef::npos;) {
+        os << rest.take_front(quote) << '\\' << rest[quote];
+        rest = rest.drop_front(quote + 1);
+    }
+    // Statements are filled like the declarations in the docs (lightblue),
+    // expressions like the terminals (lightyellow)
+    os << rest << "\";fillcolor = "
+       << (llvm::isa<ExpressionNode>(node) ? "lightyellow" : "lightblue") << ";];\n";
+
+    forEachChild(node, [&](llvm::StringRef field, ASTNode *child) {
+        unsigned childId = dumpDOT(child);
+        os << "    n" << id << " -> n" << childId;
+        if (!field.empty())
+            os << " [label = \"" << field << "\";]";
+        os << ";\n";
+    });
+    return id;
+}
+
+} // namespace umbra
@@ -0,0 +1,49 @@
+#ifndef AST_DUMPER_H
+#define AST_DUMPER_H
+
+#include "ASTNode.h"
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/raw_ostream.h>
+
+namespace llvm {
+namespace json {
+class OStream;
+} // namespace json
+} // namespace llvm
+
+namespace umbra {
+
+// Writes a tree as indented text, JSON (for tooling) or a Graphviz digraph in
+// the style of docs/syntax tree/*.dot. Output is streamed node by node into
+// `os` and nothing is rendered ahead, so memory use does not grow with the
+// tree; give it a buffered stream (llvm::outs() is unbuffered on a terminal).
+//
+// Every format names the same fields: a VariableDeclaration has a type, a
+// name and optional arraySize and initializer children, and so on. Null
+// children are left out, except null statements, which JSON keeps as null.
+class ASTDumper {
+  public:
+    enum class Format { Text, JSON, DOT };
+
+    ASTDumper(llvm::raw_ostream &os, Format format) : os(os), format(format) {}
+
+    void dump(ASTNode *root);
+
+  private:
+    void dumpText(ASTNode *node, llvm::StringRef field, unsigned depth);
+    void dumpJSON(llvm::json::OStream &json, ASTNode *node);
+    unsigned dumpDOT(ASTNode *node);
+
+    // Node name and scalar fields on one line, e.g. `VariableDeclaration int x`
+    void writeSummary(llvm::raw_ostream &out, ASTNode *node);
+
+    llvm::raw_ostream &os;
+    Format format;
+    unsigned nextId = 0;          // DOT node names
+    llvm::SmallString<128> label; // DOT label before escaping, reused
+};
+
+} // namespace umbra
+
+#endif // AST_DUMPER_H
@@ -1,16 +1,52 @@
 #ifndef ASTNODE_H
 #define ASTNODE_H
 
+#include <cstdint>
+
 namespace umbra {
 
 class ASTVisitor;
 
+// Nodes are allocated in an ASTContext and are never deleted individually.
+//
+// Every node records its concrete class in a Kind tag, which drives LLVM-style
+// RTTI: with llvm/Support/Casting.h, isa<>, cast<> and dyn_cast<> compile to
+// a compare on the tag instead of a dynamic_cast walk of type_info. Each
+// abstract base covers a contiguous range of kinds.
 class ASTNode {
   public:
+    enum class Kind : uint8_t {
+        Program,
+        Parameter,
+
+        // StatementNode
+        VariableDecl,
+        ReturnStatement,
+        FunctionDecl,
+        FirstStatement = VariableDecl,
+        LastStatement = FunctionDecl,
+
+        // ExpressionNode
+        IntegerLiteral,
+        FloatLiteral,
+        StringLiteral,
+        CharLiteral,
+        BoolLiteral,
+        Identifier,
+        FirstExpression = IntegerLiteral,
+        LastExpression = Identifier,
+    };
+
+    explicit ASTNode(Kind kind) : kind(kind) {}
     virtual ~ASTNode() = default;
     virtual void accept(ASTVisitor &visitor) = 0;
+
+    Kind getKind() const { return kind; }
+
+  private:
+    const Kind kind;
 };
 
 } // namespace umbra
 
-#endif // ASTNODE_H
\ No newline at end of file
+#endif // ASTNODE_H
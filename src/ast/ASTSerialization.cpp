@@ -0,0 +1,382 @@
+#include "ASTSerialization.h"
+#include "ASTCodes.h"
+#include "../support/BinaryReader.h"
+#include "../support/ContentHash.h"
+#include "expressionnodes/ExpressionNode.h"
+#include "statementnodes/StatementNode.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/FileUtilities.h>
+#include <llvm/Support/LEB128.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace umbra {
+
+namespace {
+
+constexpr char MAGIC[] = "UMBAST";
+constexpr size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+constexpr uint8_t VERSION = 2;
+constexpr uint8_t NULL_NODE = 0xff;
+
+llvm::StringRef toStringRef(std::string_view text) { return {text.data(), text.size()}; }
+
+// Writes nodes and numbers the symbols they use in order of first use
+class Encoder {
+  public:
+    std::vector<Symbol> symbols;
+
+    void node(llvm::raw_ostream &out, ASTNode *node);
+
+  private:
+    void symbol(llvm::raw_ostream &out, Symbol symbol) {
+        auto inserted =
+            symbolIndex.try_emplace(symbol.getId(), static_cast<uint32_t>(symbols.size()));
+        if (inserted.second)
+            symbols.push_back(symbol);
+        llvm::encodeULEB128(inserted.first->second, out);
+    }
+
+    // Anything but a type specifier is written as an invalid code, which
+    // makes the module fail to load rather than load wrong
+    void type(llvm::raw_ostream &out, TokenType type) {
+        uint8_t code = astcodes::TYPES.encode(type);
+        assert(code != astcodes::TYPES.INVALID && "not a type specifier");
+        out << static_cast<char>(code);
+    }
+
+    void text(llvm::raw_ostream &out, std::string_view text) {
+        llvm::encodeULEB128(text.size(), out);
+        out << toStringRef(text);
+    }
+
+    llvm::DenseMap<uint32_t, uint32_t> symbolIndex;
+};
+
+void Encoder::node(llvm::raw_ostream &out, ASTNode *node) {
+    if (!node) {
+        out << static_cast<char>(NULL_NODE);
+        return;
+    }
+    out << static_cast<char>(astcodes::KINDS.encode(node->getKind()));
+    switch (node->getKind()) {
+    case ASTNode::Kind::Program: {
+        llvm::ArrayRef<ASTNode *> statements = llvm::cast<ProgramNode>(node)->getStatements();
+        llvm::encodeULEB128(statements.size(), out);
+        for (ASTNode *statement : statements)
+            this->node(out, statement);
+        break;
+    }
+    case ASTNode::Kind::Parameter: {
+        auto *parameter = llvm::cast<ParameterNode>(node);
+        type(out, parameter->getType());
+        symbol(out, parameter->getName());
+        break;
+    }
+    case ASTNode::Kind::VariableDecl: {
+        auto *declaration = llvm::cast<st_VariableDeclNode>(node);
+        type(out, declaration->getType());
+        symbol(out, declaration->getName());
+        this->node(out, declaration->getArraySize());
+        this->node(out, declaration->getInitializer());
+        break;
+    }
+    case ASTNode::Kind::ReturnStatement:
+        this->node(out, llvm::cast<ReturnStatementNode>(node)->getReturnValue());
+        break;
+    case ASTNode::Kind::FunctionDecl: {
+        auto *function = llvm::cast<FunctionDeclNode>(node);
+        symbol(out, function->getName());
+        type(out, function->getReturnType());
+        llvm::encodeULEB128(function->getParams().size(), out);
+        for (ParameterNode *parameter : function->getParams())
+            this->node(out, parameter);
+
+        // The body goes through a buffer to learn its size, which lets the
+        // reader skip it
+        llvm::SmallString<256> body;
+        llvm::raw_svector_ostream bodyOut(body);
+        llvm::encodeULEB128(function->getBody().size(), bodyOut);
+        for (ASTNode *statement : function->getBody())
+            this->node(bodyOut, statement);
+        this->node(bodyOut, function->getReturnStmt());
+        llvm::encodeULEB128(body.size(), out);
+        out << body;
+        break;
+    }
+    case ASTNode::Kind::IntegerLiteral:
+        llvm::encodeULEB128(zigzagEncode(llvm::cast<ex_IntegerLiteralNode>(node)->value), out);
+        break;
+    case ASTNode::Kind::FloatLiteral: {
+        double value = llvm::cast<ex_FloatLiteralNode>(node)->value;
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        llvm::support::endian::write<uint64_t>(out, bits, llvm::support::little);
+        break;
+    }
+    case ASTNode::Kind::StringLiteral:
+        text(out, llvm::cast<ex_StringLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::CharLiteral:
+        text(out, llvm::cast<ex_CharLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::BoolLiteral:
+        out << static_cast<char>(llvm::cast<ex_BoolLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::Identifier:
+        symbol(out, llvm::cast<ex_IdentifierNode>(node)->name);
+        break;
+    }
+}
+
+TokenType readType(BinaryReader &in) {
+    TokenType type = TokenType::TOK_EOF;
+    if (!astcodes::TYPES.decode(in.byte(), type))
+        in.failed = true;
+    return type;
+}
+
+} // namespace
+
+/* ASTWriter */
+
+std::string ASTWriter::serialize(ProgramNode &program, const SourceBuffer &buffer) {
+    // Nodes first, since the symbol table that precedes them is built on the way
+    Encoder encoder;
+    std::string nodes;
+    llvm::raw_string_ostream nodesOut(nodes);
+    encoder.node(nodesOut, &program);
+    nodesOut.flush();
+
+    std::string data;
+    llvm::raw_string_ostream out(data);
+    out << llvm::StringRef(MAGIC, MAGIC_SIZE);
+    out << static_cast<char>(VERSION) << '\0';
+    llvm::support::endian::write<uint64_t>(out, contentHash(buffer.getText()),
+                                           llvm::support::little);
+    llvm::encodeULEB128(buffer.size(), out);
+    llvm::encodeULEB128(encoder.symbols.size(), out);
+    for (Symbol symbol : encoder.symbols) {
+        std::string_view spelling = symbol.str();
+        llvm::encodeULEB128(spelling.size(), out);
+        out << toStringRef(spelling);
+    }
+    out << nodes;
+    out.flush();
+    return data;
+}
+
+/* ASTReader */
+
+std::unique_ptr<ASTReader> ASTReader::create(std::unique_ptr<llvm::MemoryBuffer> data,
+                                             ASTContext &context) {
+    std::unique_ptr<ASTReader> reader(new ASTReader(std::move(data), context));
+    BinaryReader in(reader->data->getBuffer());
+    if (!reader->readHeader(in))
+        return nullptr;
+    reader->program = reader->readNodeOf<ProgramNode>(in);
+    if (in.failed || !reader->program || !in.atEnd())
+        return nullptr;
+    return reader;
+}
+
+std::unique_ptr<ASTReader> ASTReader::open(const std::string &path, ASTContext &context) {
+    auto data = llvm::MemoryBuffer::getFile(path, /*IsText=*/false,
+                                            /*RequiresNullTerminator=*/false);
+    if (!data)
+        return nullptr;
+    return create(std::move(*data), context);
+}
+
+bool ASTReader::isFor(const SourceBuffer &buffer) const {
+    return sourceSize == buffer.size() && sourceHash == contentHash(buffer.getText());
+}
+
+bool ASTReader::readHeader(BinaryReader &in) {
+    if (in.bytes(MAGIC_SIZE) != llvm::StringRef(MAGIC, MAGIC_SIZE) || in.byte() != VERSION)
+        return false;
+    in.byte(); // reserved
+    sourceHash = in.u64();
+    sourceSize = in.uleb();
+    uint64_t symbolCount = in.uleb();
+    // Each entry takes at least one byte, which bounds what we reserve
+    if (in.failed || symbolCount > data->getBufferSize())
+        return false;
+
+    // Symbol IDs are per process, so spellings are interned again
+    symbols.reserve(symbolCount);
+    for (uint64_t i = 0; i < symbolCount; ++i) {
+        llvm::StringRef spelling = in.bytes(in.uleb());
+        if (in.failed)
+            return false;
+        symbols.push_back(SymbolTable::global().intern({spelling.data(), spelling.size()}));
+    }
+    return true;
+}
+
+Symbol ASTReader::readSymbol(BinaryReader &in) {
+    uint64_t index = in.uleb();
+    if (index >= symbols.size()) {
+        in.failed = true;
+        return Symbol();
+    }
+    return symbols[index];
+}
+
+template <typename T> T *ASTReader::readNodeOf(BinaryReader &in) {
+    ASTNode *node = readNode(in);
+    if (node && !llvm::isa<T>(node)) {
+        in.failed = true;
+        return nullptr;
+    }
+    return llvm::cast_or_null<T>(node);
+}
+
+llvm::ArrayRef<ASTNode *> ASTReader::readStatements(BinaryReader &in) {
+    uint64_t count = in.uleb();
+    if (count > data->getBufferSize())
+        in.failed = true;
+    llvm::SmallVector<ASTNode *, 64> statements;
+    for (uint64_t i = 0; i < count && !in.failed; ++i)
+        statements.push_back(readNodeOf<StatementNode>(in));
+    if (in.failed)
+        return {};
+    return context.copyArray<ASTNode *>(statements);
+}
+
+ASTNode *ASTReader::readNode(BinaryReader &in) {
+    uint8_t tag = in.byte();
+    if (in.failed || tag == NULL_NODE)
+        return nullptr;
+    ASTNode::Kind kind;
+    if (!astcodes::KINDS.decode(tag, kind)) {
+        in.failed = true;
+        return nullptr;
+    }
+
+    // Nodes are created even from a record that turns out to be malformed;
+    // the caller then drops the whole context or throws
+    switch (kind) {
+    case ASTNode::Kind::Program:
+        return context.create<ProgramNode>(readStatements(in));
+    case ASTNode::Kind::Parameter: {
+        TokenType type = readType(in);
+        Symbol name = readSymbol(in);
+        return context.create<ParameterNode>(type, name);
+    }
+    case ASTNode::Kind::VariableDecl: {
+        TokenType type = readType(in);
+        Symbol name = readSymbol(in);
+        ExpressionNode *arraySize = readNodeOf<ExpressionNode>(in);
+        ExpressionNode *initializer = readNodeOf<ExpressionNode>(in);
+        return context.create<st_VariableDeclNode>(type, name, initializer, arraySize);
+    }
+    case ASTNode::Kind::ReturnStatement:
+        return context.create<ReturnStatementNode>(readNodeOf<ExpressionNode>(in));
+    case ASTNode::Kind::FunctionDecl: {
+        Symbol name = readSymbol(in);
+        TokenType returnType = readType(in);
+        uint64_t count = in.uleb();
+        if (count > data->getBufferSize())
+            in.failed = true;
+        llvm::SmallVector<ParameterNode *, 8> params;
+        for (uint64_t i = 0; i < count && !in.failed; ++i) {
+            ParameterNode *parameter = readNodeOf<ParameterNode>(in);
+            if (!parameter)
+                in.failed = true;
+            params.push_back(parameter);
+        }
+        // Skip the body; readFunctionBody() comes back for it
+        uint64_t bodyOffset = in.tell();
+        in.bytes(in.uleb());
+        if (in.failed)
+            return nullptr;
+        auto *function = context.create<FunctionDeclNode>(
+            name, context.copyArray<ParameterNode *>(params), returnType,
+            llvm::ArrayRef<ASTNode *>(), nullptr);
+        function->setLazyBody(this, bodyOffset);
+        return function;
+    }
+    case ASTNode::Kind::IntegerLiteral:
+        return context.getIntegerLiteral(zigzagDecode(in.uleb()));
+    case ASTNode::Kind::FloatLiteral: {
+        uint64_t bits = in.u64();
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return context.getFloatLiteral(value);
+    }
+    case ASTNode::Kind::StringLiteral: {
+        llvm::StringRef text = in.bytes(in.uleb());
+        return context.getStringLiteral(std::string_view(text.data(), text.size()));
+    }
+    case ASTNode::Kind::CharLiteral: {
+        llvm::StringRef text = in.bytes(in.uleb());
+        return context.getCharLiteral(std::string_view(text.data(), text.size()));
+    }
+    case ASTNode::Kind::BoolLiteral:
+        return context.getBoolLiteral(in.byte() != 0);
+    case ASTNode::Kind::Identifier:
+        return context.getIdentifier(readSymbol(in));
+    }
+    in.failed = true;
+    return nullptr;
+}
+
+FunctionBody ASTReader::readFunctionBody(uint64_t offset) {
+    // Positions are absolute, so nested functions record offsets the same way
+    BinaryReader in(data->getBuffer());
+    in.bytes(offset);
+    uint64_t size = in.uleb();
+    uint64_t end = in.tell() + size;
+
+    FunctionBody body;
+    body.statements = readStatements(in);
+    body.returnStmt = readNodeOf<ReturnStatementNode>(in);
+    if (in.failed || in.tell() != end) {
+        throw std::runtime_error("Malformed function body in " +
+                                 data->getBufferIdentifier().str());
+    }
+    return body;
+}
+
+/* ASTCache */
+
+std::string ASTCache::pathFor(const SourceBuffer &buffer) const {
+    llvm::SmallString<128> path(directory);
+    llvm::sys::path::append(path, llvm::utohexstr(contentHash(buffer.getText()),
+                                                  /*LowerCase=*/true) +
+                                      ".umbast");
+    return std::string(path.str());
+}
+
+std::unique_ptr<ASTReader> ASTCache::load(const SourceBuffer &buffer,
+                                          ASTContext &context) const {
+    std::unique_ptr<ASTReader> reader = ASTReader::open(pathFor(buffer), context);
+    if (!reader || !reader->isFor(buffer))
+        return nullptr;
+    return reader;
+}
+
+bool ASTCache::store(ProgramNode &program, const SourceBuffer &buffer) const {
+    if (llvm::sys::fs::create_directories(directory))
+        return false;
+    std::string path = pathFor(buffer);
+    // Readers never observe a partially written entry
+    if (llvm::Error error = llvm::writeFileAtomically(path + ".tmp%%%%%%", path,
+                                                      ASTWriter::serialize(program, buffer))) {
+        llvm::consumeError(std::move(error));
+        return false;
+    }
+    return true;
+}
+
+} // namespace umbra
@@ -0,0 +1,110 @@
+#ifndef AST_SERIALIZATION_H
+#define AST_SERIALIZATION_H
+
+#include "../lexer/SourceBuffer.h"
+#include "../lexer/SymbolTable.h"
+#include "ASTContext.h"
+#include "ExternalASTSource.h"
+#include "ProgramNode.h"
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace umbra {
+
+class BinaryReader;
+
+// Binary form of a parsed program (.umbast), written by ASTWriter and mapped
+// back by ASTReader. It holds no pointers or absolute offsets, so an entry can
+// be moved or mapped anywhere, and the body of every function is a
+// length-prefixed block that the reader skips until the body is first used.
+//
+// Format (little endian):
+//   "UMBAST" version:u8 reserved:u8 sourceHash:u64 sourceSize:uleb
+//   symbolCount:uleb symbols: { length:uleb bytes }*
+//   root: node
+// where a node is kind:u8 (a node kind code, or 0xff for null) followed by
+//   Program          count:uleb statement:node*
+//   Parameter        type:u8 name:uleb
+//   VariableDecl     type:u8 name:uleb arraySize:node initializer:node
+//   ReturnStatement  value:node
+//   FunctionDecl     name:uleb returnType:u8 count:uleb Parameter*
+//                    bodySize:uleb body: { count:uleb statement:node* return:node }
+//   IntegerLiteral   zigzag:uleb
+//   FloatLiteral     bits:u64
+//   String/Char      length:uleb bytes
+//   BoolLiteral      value:u8
+//   Identifier       name:uleb
+// Names are indices into the symbol table. Node kinds and types are the fixed
+// codes of ASTCodes.h, not ASTNode::Kind or TokenType values, so reordering
+// either enum leaves modules readable. The version changes whenever the
+// encoding or those code tables do.
+class ASTWriter {
+  public:
+    // Encodes `program`, parsed from `buffer`. Lazy bodies are loaded first.
+    static std::string serialize(ProgramNode &program, const SourceBuffer &buffer);
+};
+
+// A module mapped into memory. Everything but function bodies is decoded up
+// front into the ASTContext; each body is decoded on the first getBody() of
+// its function. Literal text points into the mapped file, so the reader must
+// outlive the nodes it creates.
+class ASTReader : public ExternalASTSource {
+  public:
+    // Nothing if the data is not a well-formed module. Bodies are only
+    // checked when they are read, and throw then.
+    static std::unique_ptr<ASTReader> create(std::unique_ptr<llvm::MemoryBuffer> data,
+                                             ASTContext &context);
+    // Maps the file at `path`; nothing if it cannot be read or is malformed
+    static std::unique_ptr<ASTReader> open(const std::string &path, ASTContext &context);
+
+    ProgramNode *getProgram() const { return program; }
+    // True if the module was written from exactly these bytes
+    bool isFor(const SourceBuffer &buffer) const;
+
+    FunctionBody readFunctionBody(uint64_t offset) override;
+
+  private:
+    ASTReader(std::unique_ptr<llvm::MemoryBuffer> data, ASTContext &context)
+        : data(std::move(data)), context(context) {}
+
+    bool readHeader(BinaryReader &in);
+    // Null for the null tag; sets in.failed on malformed input
+    ASTNode *readNode(BinaryReader &in);
+    template <typename T> T *readNodeOf(BinaryReader &in);
+    llvm::ArrayRef<ASTNode *> readStatements(BinaryReader &in);
+    Symbol readSymbol(BinaryReader &in);
+
+    std::unique_ptr<llvm::MemoryBuffer> data;
+    ASTContext &context;
+    std::vector<Symbol> symbols;
+    ProgramNode *program = nullptr;
+    uint64_t sourceHash = 0;
+    uint64_t sourceSize = 0;
+};
+
+// On-disk cache of parsed programs, keyed like TokenCache by an xxHash64 of
+// the source: an unchanged file maps its .umbast entry and skips lexing and
+// parsing altogether. Only programs that compiled without errors should be
+// stored, since diagnostics are not recorded.
+class ASTCache {
+  public:
+    explicit ASTCache(std::string directory) : directory(std::move(directory)) {}
+
+    // Cached tree for `buffer`, or nothing on a miss or an unreadable entry
+    std::unique_ptr<ASTReader> load(const SourceBuffer &buffer, ASTContext &context) const;
+    // Returns false if the entry could not be written
+    bool store(ProgramNode &program, const SourceBuffer &buffer) const;
+
+    std::string pathFor(const SourceBuffer &buffer) const;
+
+  private:
+    std::string directory;
+};
+
+} // namespace umbra
+
+#endif // AST_SERIALIZATION_H
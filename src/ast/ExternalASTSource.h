@@ -0,0 +1,30 @@
+#ifndef EXTERNAL_AST_SOURCE_H
+#define EXTERNAL_AST_SOURCE_H
+
+#include <llvm/ADT/ArrayRef.h>
+#include <cstdint>
+
+namespace umbra {
+
+class ASTNode;
+class ReturnStatementNode;
+
+struct FunctionBody {
+    llvm::ArrayRef<ASTNode *> statements;
+    ReturnStatementNode *returnStmt = nullptr;
+};
+
+// Supplies parts of a tree that are materialized on first use. A function
+// loaded from a precompiled module (see ASTReader) keeps only an offset into
+// it, and asks its source for the body when getBody() is first called.
+class ExternalASTSource {
+  public:
+    virtual ~ExternalASTSource() = default;
+
+    // Body stored at `offset`. Throws std::runtime_error if it cannot be read.
+    virtual FunctionBody readFunctionBody(uint64_t offset) = 0;
+};
+
+} // namespace umbra
+
+#endif // EXTERNAL_AST_SOURCE_H
@@ -0,0 +1,143 @@
+#include "FlatAST.h"
+#include "visitor/ASTVisitor.h"
+#include <llvm/ADT/SmallVector.h>
+#include <cstring>
+
+namespace umbra {
+
+// Appends each visited node in pre-order; `last` is the index of the node
+// the latest accept() produced
+class FlatAST::Builder : public ASTVisitor {
+  public:
+    explicit Builder(FlatAST &ast) : ast(ast) {}
+
+    NodeId add(ASTNode *node) {
+        if (!node)
+            return NONE;
+        node->accept(*this);
+        return last;
+    }
+
+    void visit(ProgramNode &node) override {
+        NodeId id = push(FlatKind::Program);
+        llvm::SmallVector<NodeId, 64> statements;
+        addAll(node.getStatements(), statements);
+        setChildren(id, statements);
+    }
+
+    void visit(st_VariableDeclNode &node) override {
+        NodeId id = push(FlatKind::VariableDecl);
+        ast.nodes[id].aux = static_cast<uint8_t>(node.getType());
+        ast.nodes[id].data[0] = node.getName().getId();
+        NodeId initializer = add(node.getInitializer());
+        NodeId arraySize = add(node.getArraySize());
+        ast.nodes[id].data[1] = initializer;
+        ast.nodes[id].data[2] = arraySize;
+        last = id;
+    }
+
+    void visit(ParameterNode &node) override {
+        last = push(FlatKind::Parameter, node.getName().getId());
+        ast.nodes[last].aux = static_cast<uint8_t>(node.getType());
+    }
+
+    void visit(ReturnStatementNode &node) override {
+        NodeId id = push(FlatKind::ReturnStatement);
+        ast.nodes[id].data[0] = add(node.getReturnValue());
+        last = id;
+    }
+
+    void visit(FunctionDeclNode &node) override {
+        NodeId id = push(FlatKind::FunctionDecl, node.getName().getId());
+        ast.nodes[id].aux = static_cast<uint8_t>(node.getReturnType());
+        llvm::SmallVector<NodeId, 16> children;
+        for (ParameterNode *parameter : node.getParams())
+            children.push_back(add(parameter));
+        addAll(node.getBody(), children);
+        if (node.getReturnStmt())
+            children.push_back(add(node.getReturnStmt()));
+        setChildren(id, children);
+    }
+
+    void visit(ex_IntegerLiteralNode &node) override {
+        last = push(FlatKind::IntegerLiteral, static_cast<uint32_t>(ast.integers.size()));
+        ast.integers.push_back(node.value);
+    }
+
+    void visit(ex_FloatLiteralNode &node) override {
+        last = push(FlatKind::FloatLiteral, static_cast<uint32_t>(ast.reals.size()));
+        ast.reals.push_back(node.value);
+    }
+
+    void visit(ex_StringLiteralNode &node) override {
+        last = pushText(FlatKind::StringLiteral, node.value);
+    }
+
+    void visit(ex_CharLiteralNode &node) override {
+        last = pushText(FlatKind::CharLiteral, node.value);
+    }
+
+    void visit(ex_BoolLiteralNode &node) override {
+        last = push(FlatKind::BoolLiteral);
+        ast.nodes[last].aux = node.value;
+    }
+
+    void visit(ex_IdentifierNode &node) override {
+        last = push(FlatKind::Identifier, node.name.getId());
+    }
+
+  private:
+    // Null statements are left out
+    void addAll(llvm::ArrayRef<ASTNode *> statements, llvm::SmallVectorImpl<NodeId> &ids) {
+        for (ASTNode *statement : statements) {
+            if (statement)
+                ids.push_back(add(statement));
+        }
+    }
+
+    // Children are appended once all of them are built, so that nested
+    // lists, which are appended first, do not interleave with them
+    void setChildren(NodeId id, llvm::ArrayRef<NodeId> children) {
+        ast.nodes[id].data[1] = static_cast<uint32_t>(ast.childIds.size());
+        ast.nodes[id].data[2] = static_cast<uint32_t>(children.size());
+        ast.childIds.insert(ast.childIds.end(), children.begin(), children.end());
+        last = id;
+    }
+
+    NodeId push(FlatKind kind, uint32_t data0 = 0, uint32_t data1 = 0) {
+        ast.nodes.push_back(FlatNode{kind, 0, 0, {data0, data1, 0}});
+        return static_cast<NodeId>(ast.nodes.size() - 1);
+    }
+
+    NodeId pushText(FlatKind kind, std::string_view text) {
+        auto offset = static_cast<uint32_t>(text.data() - ast.buffer->begin());
+        return push(kind, offset, static_cast<uint32_t>(text.size()));
+    }
+
+    FlatAST &ast;
+    NodeId last = NONE;
+};
+
+FlatAST FlatAST::build(ProgramNode &program, const SourceBuffer &buffer) {
+    FlatAST ast(buffer);
+    Builder(ast).add(&program);
+    return ast;
+}
+
+namespace {
+
+template <typename T> bool sameBytes(const std::vector<T> &a, const std::vector<T> &b) {
+    return a.size() == b.size() && (a.empty() || !std::memcmp(a.data(), b.data(),
+                                                               a.size() * sizeof(T)));
+}
+
+} // namespace
+
+bool FlatAST::operator==(const FlatAST &other) const {
+    // Byte comparison, so trees holding the same NaN payload compare equal
+    return buffer == other.buffer && sameBytes(nodes, other.nodes) &&
+           sameBytes(childIds, other.childIds) && sameBytes(integers, other.integers) &&
+           sameBytes(reals, other.reals);
+}
+
+} // namespace umbra
@@ -0,0 +1,113 @@
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include "../lexer/SourceBuffer.h"
+#include "../lexer/SymbolTable.h"
+#include "../lexer/Tokens.h"
+#include "ProgramNode.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace umbra {
+
+enum class FlatKind : uint8_t {
+    Program,
+    VariableDecl,
+    IntegerLiteral,
+    FloatLiteral,
+    StringLiteral,
+    CharLiteral,
+    BoolLiteral,
+    Identifier,
+    Parameter,
+    ReturnStatement,
+    FunctionDecl,
+};
+
+// One node of a FlatAST. Its meaning depends on the kind:
+//   Program         data = {-, first child in children(), child count}
+//   VariableDecl    aux = declared TokenType,
+//                   data = {name symbol, initializer node, array size node}
+//   IntegerLiteral  data = {index into the integer table, -, -}
+//   FloatLiteral    data = {index into the float table, -, -}
+//   String/Char     data = {source offset of the body, body length, -}
+//   BoolLiteral     aux = value
+//   Identifier      data = {symbol, -, -}
+//   Parameter       aux = declared TokenType, data = {name symbol, -, -}
+//   ReturnStatement data = {value node, -, -}
+//   FunctionDecl    aux = return TokenType,
+//                   data = {name symbol, first child in children(), child count}
+//                   where the children are the parameters, the body and the
+//                   return statement, if any, in that order
+// Unused fields are zero, so equal trees are equal byte for byte.
+struct FlatNode {
+    FlatKind kind;
+    uint8_t aux;
+    uint16_t reserved;
+    uint32_t data[3];
+};
+
+static_assert(sizeof(FlatNode) == 16, "FlatNode should stay at 16 bytes");
+static_assert(std::is_trivially_copyable<FlatNode>::value, "FlatNode is copied with memcpy");
+
+// Data-oriented copy of a parsed program. Nodes live in one contiguous array in
+// pre-order (every node precedes its children) and refer to each other by
+// 32-bit index; the list of a program's statements is an index range into
+// children(), and literal payloads that do not fit in a node go to side
+// tables. Passes that only need to scan nodes of a kind walk nodes() linearly
+// instead of chasing pointers, and the arrays can be copied, hashed or written
+// out directly.
+class FlatAST {
+  public:
+    using NodeId = uint32_t;
+    static constexpr NodeId NONE = UINT32_MAX;
+
+    // String and char literals of `program` must be slices of `buffer`
+    static FlatAST build(ProgramNode &program, const SourceBuffer &buffer);
+
+    NodeId getRoot() const { return 0; }
+    size_t size() const { return nodes.size(); }
+    llvm::ArrayRef<FlatNode> getNodes() const { return nodes; }
+    const FlatNode &operator[](NodeId id) const { return nodes[id]; }
+    FlatKind kind(NodeId id) const { return nodes[id].kind; }
+
+    // Program and FunctionDecl
+    llvm::ArrayRef<NodeId> children(NodeId id) const {
+        return llvm::ArrayRef<NodeId>(childIds).slice(nodes[id].data[1], nodes[id].data[2]);
+    }
+    // VariableDecl, Parameter and FunctionDecl (return type)
+    TokenType declType(NodeId id) const { return static_cast<TokenType>(nodes[id].aux); }
+    NodeId initializer(NodeId id) const { return nodes[id].data[1]; }
+    NodeId arraySize(NodeId id) const { return nodes[id].data[2]; }
+    // ReturnStatement
+    NodeId returnValue(NodeId id) const { return nodes[id].data[0]; }
+    // Declarations and Identifier
+    Symbol name(NodeId id) const { return Symbol(nodes[id].data[0]); }
+    // Literals
+    int64_t integer(NodeId id) const { return integers[nodes[id].data[0]]; }
+    double real(NodeId id) const { return reals[nodes[id].data[0]]; }
+    bool boolean(NodeId id) const { return nodes[id].aux != 0; }
+    std::string_view text(NodeId id) const {
+        return buffer->getText().substr(nodes[id].data[0], nodes[id].data[1]);
+    }
+
+    bool operator==(const FlatAST &other) const;
+    bool operator!=(const FlatAST &other) const { return !(*this == other); }
+
+  private:
+    class Builder;
+    explicit FlatAST(const SourceBuffer &buffer) : buffer(&buffer) {}
+
+    const SourceBuffer *buffer;
+    std::vector<FlatNode> nodes;
+    std::vector<NodeId> childIds;
+    std::vector<int64_t> integers;
+    std::vector<double> reals;
+};
+
+} // namespace umbra
+
+#endif // FLAT_AST_H
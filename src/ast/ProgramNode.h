@@ -2,22 +2,23 @@
 #define PROGRAM_NODE_H
 
 #include "ASTNode.h"
-#include <memory>
-#include <vector>
+#include <llvm/ADT/ArrayRef.h>
 
 namespace umbra {
 
 class ProgramNode : public ASTNode {
   public:
-    ProgramNode(std::vector<std::unique_ptr<ASTNode>> ast) : ast(std::move(ast)) {}
+    // `ast` lives in the same ASTContext as the node
+    ProgramNode(llvm::ArrayRef<ASTNode *> ast) : ASTNode(Kind::Program), ast(ast) {}
 
-    const std::vector<std::unique_ptr<ASTNode>> &getStatements() const { return ast; }
+    llvm::ArrayRef<ASTNode *> getStatements() const { return ast; }
 
     void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::Program; }
     ~ProgramNode() noexcept override = default;
 
   private:
-    std::vector<std::unique_ptr<ASTNode>> ast;
+    llvm::ArrayRef<ASTNode *> ast;
 };
 
 } // namespace umbra
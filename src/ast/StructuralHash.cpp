@@ -0,0 +1,186 @@
+#include "StructuralHash.h"
+#include "ASTCodes.h"
+#include "ProgramNode.h"
+#include "expressionnodes/ExpressionNode.h"
+#include "statementnodes/StatementNode.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/xxhash.h>
+#include <cstring>
+#include <string_view>
+
+namespace umbra {
+
+namespace {
+
+// A null child; no node hashes to it in practice
+constexpr uint64_t NULL_HASH = 0;
+
+uint64_t hashText(std::string_view text) {
+    return llvm::xxHash64(llvm::StringRef(text.data(), text.size()));
+}
+
+uint64_t floatBits(double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// Each node hashes the list [kind, values..., child hashes...], so a subtree's
+// hash covers everything below it (a Merkle tree)
+class Hasher {
+  public:
+    void add(uint64_t word) {
+        words.push_back(llvm::support::endian::byte_swap(word, llvm::support::little));
+    }
+    void addChild(const ASTNode *child) { add(structuralHash(child)); }
+    void addChildren(llvm::ArrayRef<ASTNode *> children) {
+        add(children.size());
+        for (const ASTNode *child : children)
+            addChild(child);
+    }
+
+    uint64_t finish() const {
+        return llvm::xxHash64(llvm::StringRef(reinterpret_cast<const char *>(words.data()),
+                                              words.size() * sizeof(uint64_t)));
+    }
+
+  private:
+    llvm::SmallVector<uint64_t, 8> words;
+};
+
+bool allEqual(llvm::ArrayRef<ASTNode *> a, llvm::ArrayRef<ASTNode *> b) {
+    if (a.size() != b.size())
+        return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (!structurallyEqual(a[i], b[i]))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+uint64_t structuralHash(const ASTNode *node) {
+    if (!node)
+        return NULL_HASH;
+
+    Hasher hasher;
+    hasher.add(astcodes::KINDS.encode(node->getKind()));
+    switch (node->getKind()) {
+    case ASTNode::Kind::Program:
+        hasher.addChildren(llvm::cast<ProgramNode>(node)->getStatements());
+        break;
+    case ASTNode::Kind::Parameter: {
+        auto *parameter = llvm::cast<ParameterNode>(node);
+        hasher.add(astcodes::TYPES.encode(parameter->getType()));
+        hasher.add(hashText(parameter->getName().str()));
+        break;
+    }
+    case ASTNode::Kind::VariableDecl: {
+        auto *declaration = llvm::cast<st_VariableDeclNode>(node);
+        hasher.add(astcodes::TYPES.encode(declaration->getType()));
+        hasher.add(hashText(declaration->getName().str()));
+        hasher.addChild(declaration->getArraySize());
+        hasher.addChild(declaration->getInitializer());
+        break;
+    }
+    case ASTNode::Kind::ReturnStatement:
+        hasher.addChild(llvm::cast<ReturnStatementNode>(node)->getReturnValue());
+        break;
+    case ASTNode::Kind::FunctionDecl: {
+        auto *function = llvm::cast<FunctionDeclNode>(node);
+        hasher.add(hashText(function->getName().str()));
+        hasher.add(astcodes::TYPES.encode(function->getReturnType()));
+        hasher.add(function->getParams().size());
+        for (const ParameterNode *parameter : function->getParams())
+            hasher.addChild(parameter);
+        hasher.addChildren(function->getBody());
+        hasher.addChild(function->getReturnStmt());
+        break;
+    }
+    case ASTNode::Kind::IntegerLiteral:
+        hasher.add(static_cast<uint64_t>(llvm::cast<ex_IntegerLiteralNode>(node)->value));
+        break;
+    case ASTNode::Kind::FloatLiteral:
+        hasher.add(floatBits(llvm::cast<ex_FloatLiteralNode>(node)->value));
+        break;
+    case ASTNode::Kind::StringLiteral:
+        hasher.add(hashText(llvm::cast<ex_StringLiteralNode>(node)->value));
+        break;
+    case ASTNode::Kind::CharLiteral:
+        hasher.add(hashText(llvm::cast<ex_CharLiteralNode>(node)->value));
+        break;
+    case ASTNode::Kind::BoolLiteral:
+        hasher.add(llvm::cast<ex_BoolLiteralNode>(node)->value);
+        break;
+    case ASTNode::Kind::Identifier:
+        hasher.add(hashText(llvm::cast<ex_IdentifierNode>(node)->name.str()));
+        break;
+    }
+    return hasher.finish();
+}
+
+bool structurallyEqual(const ASTNode *a, const ASTNode *b) {
+    if (a == b)
+        return true;
+    if (!a || !b || a->getKind() != b->getKind())
+        return false;
+
+    switch (a->getKind()) {
+    case ASTNode::Kind::Program:
+        return allEqual(llvm::cast<ProgramNode>(a)->getStatements(),
+                        llvm::cast<ProgramNode>(b)->getStatements());
+    case ASTNode::Kind::Parameter: {
+        auto *x = llvm::cast<ParameterNode>(a);
+        auto *y = llvm::cast<ParameterNode>(b);
+        return x->getType() == y->getType() && x->getName() == y->getName();
+    }
+    case ASTNode::Kind::VariableDecl: {
+        auto *x = llvm::cast<st_VariableDeclNode>(a);
+        auto *y = llvm::cast<st_VariableDeclNode>(b);
+        return x->getType() == y->getType() && x->getName() == y->getName() &&
+               structurallyEqual(x->getArraySize(), y->getArraySize()) &&
+               structurallyEqual(x->getInitializer(), y->getInitializer());
+    }
+    case ASTNode::Kind::ReturnStatement:
+        return structurallyEqual(llvm::cast<ReturnStatementNode>(a)->getReturnValue(),
+                                 llvm::cast<ReturnStatementNode>(b)->getReturnValue());
+    case ASTNode::Kind::FunctionDecl: {
+        auto *x = llvm::cast<FunctionDeclNode>(a);
+        auto *y = llvm::cast<FunctionDeclNode>(b);
+        if (x->getName() != y->getName() || x->getReturnType() != y->getReturnType() ||
+            x->getParams().size() != y->getParams().size())
+            return false;
+        for (size_t i = 0; i < x->getParams().size(); ++i) {
+            if (!structurallyEqual(x->getParams()[i], y->getParams()[i]))
+                return false;
+        }
+        return allEqual(x->getBody(), y->getBody()) &&
+               structurallyEqual(x->getReturnStmt(), y->getReturnStmt());
+    }
+    case ASTNode::Kind::IntegerLiteral:
+        return llvm::cast<ex_IntegerLiteralNode>(a)->value ==
+               llvm::cast<ex_IntegerLiteralNode>(b)->value;
+    case ASTNode::Kind::FloatLiteral:
+        return floatBits(llvm::cast<ex_FloatLiteralNode>(a)->value) ==
+               floatBits(llvm::cast<ex_FloatLiteralNode>(b)->value);
+    case ASTNode::Kind::StringLiteral:
+        return llvm::cast<ex_StringLiteralNode>(a)->value ==
+               llvm::cast<ex_StringLiteralNode>(b)->value;
+    case ASTNode::Kind::CharLiteral:
+        return llvm::cast<ex_CharLiteralNode>(a)->value ==
+               llvm::cast<ex_CharLiteralNode>(b)->value;
+    case ASTNode::Kind::BoolLiteral:
+        return llvm::cast<ex_BoolLiteralNode>(a)->value ==
+               llvm::cast<ex_BoolLiteralNode>(b)->value;
+    case ASTNode::Kind::Identifier:
+        return llvm::cast<ex_IdentifierNode>(a)->name == llvm::cast<ex_IdentifierNode>(b)->name;
+    }
+    return false;
+}
+
+} // namespace umbra
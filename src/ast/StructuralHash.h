@@ -0,0 +1,24 @@
+#ifndef STRUCTURAL_HASH_H
+#define STRUCTURAL_HASH_H
+
+#include "ASTNode.h"
+#include <cstdint>
+
+namespace umbra {
+
+// Hash of a subtree's structure and values, independent of where its nodes
+// live. It is stable across processes, platforms and builds (names are hashed
+// by spelling, not Symbol ID, kinds and types by their ASTCodes.h codes, and
+// every word little endian), so it can key on-disk caches for incremental
+// compilation. Equal hashes are a cheap
+// filter; confirm with structurallyEqual() where a collision would matter.
+// Floats are compared bit for bit. Null hashes like a null child.
+uint64_t structuralHash(const ASTNode *node);
+
+// True if both subtrees have the same shape and values. With uniquing on in
+// ASTContext equal leaves are the same node, which short-circuits here.
+bool structurallyEqual(const ASTNode *a, const ASTNode *b);
+
+} // namespace umbra
+
+#endif // STRUCTURAL_HASH_H
@@ -3,22 +3,28 @@
 
 namespace umbra {
 
-ex_IntegerLiteralNode::ex_IntegerLiteralNode(int value) : value(value) {}
+ex_IntegerLiteralNode::ex_IntegerLiteralNode(int64_t value)
+    : ExpressionNode(Kind::IntegerLiteral), value(value) {}
 void ex_IntegerLiteralNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
 
-ex_FloatLiteralNode ::ex_FloatLiteralNode(double value) : value(value) {}
+ex_FloatLiteralNode ::ex_FloatLiteralNode(double value)
+    : ExpressionNode(Kind::FloatLiteral), value(value) {}
 void ex_FloatLiteralNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
 
-ex_StringLiteralNode::ex_StringLiteralNode(std::string value) : value(value) {};
+ex_StringLiteralNode::ex_StringLiteralNode(std::string_view value)
+    : ExpressionNode(Kind::StringLiteral), value(value) {};
 void ex_StringLiteralNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
 
-ex_CharLiteralNode::ex_CharLiteralNode(std::string value) : value(value) {};
+ex_CharLiteralNode::ex_CharLiteralNode(std::string_view value)
+    : ExpressionNode(Kind::CharLiteral), value(value) {};
 void ex_CharLiteralNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
 
-ex_BoolLiteralNode ::ex_BoolLiteralNode(bool value) : value(value) {};
+ex_BoolLiteralNode ::ex_BoolLiteralNode(bool value)
+    : ExpressionNode(Kind::BoolLiteral), value(value) {};
 void ex_BoolLiteralNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
 
-ex_IdentifierNode ::ex_IdentifierNode(const std::string &name) : name(name) {}
+ex_IdentifierNode ::ex_IdentifierNode(Symbol name)
+    : ExpressionNode(Kind::Identifier), name(name) {}
 void ex_IdentifierNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
 
 } // namespace umbra
\ No newline at end of file
@@ -1,64 +1,79 @@
 #ifndef EXPRESSIONNODE_H
 #define EXPRESSIONNODE_H
 
+#include "../../lexer/SymbolTable.h"
 #include "../ASTNode.h"
-#include <string>
+#include <cstdint>
+#include <string_view>
 
 namespace umbra {
 
 class ASTVisitor;
 
+// Leaf expressions are immutable once created, so that ASTContext can share
+// one node between every use of the same value (see ASTContext::setUniquing).
 class ExpressionNode : public ASTNode {
   public:
+    explicit ExpressionNode(Kind kind) : ASTNode(kind) {}
     void accept(ASTVisitor &visitor) = 0;
+    static bool classof(const ASTNode *node) {
+        return node->getKind() >= Kind::FirstExpression &&
+               node->getKind() <= Kind::LastExpression;
+    }
     virtual ~ExpressionNode() noexcept = default;
 };
 
 class ex_IntegerLiteralNode : public ExpressionNode {
   public:
-    int value;
-    ex_IntegerLiteralNode(int value);
+    const int64_t value;
+    ex_IntegerLiteralNode(int64_t value);
     void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::IntegerLiteral; }
     virtual ~ex_IntegerLiteralNode() noexcept = default;
 };
 
 class ex_FloatLiteralNode : public ExpressionNode {
   public:
-    double value;
+    const double value;
     ex_FloatLiteralNode(double value);
     void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::FloatLiteral; }
     virtual ~ex_FloatLiteralNode() noexcept = default;
 };
 
 class ex_StringLiteralNode : public ExpressionNode {
   public:
-    std::string value;
-    ex_StringLiteralNode(std::string value);
+    const std::string_view value;
+    ex_StringLiteralNode(std::string_view value);
     void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::StringLiteral; }
     virtual ~ex_StringLiteralNode() noexcept = default;
 };
 
 class ex_CharLiteralNode : public ExpressionNode {
   public:
-    std::string value;
-    ex_CharLiteralNode(std::string value);
+    const std::string_view value;
+    ex_CharLiteralNode(std::string_view value);
     void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::CharLiteral; }
     virtual ~ex_CharLiteralNode() noexcept = default;
 };
 
 class ex_BoolLiteralNode : public ExpressionNode {
   public:
-    bool value;
+    const bool value;
     ex_BoolLiteralNode(bool value);
     void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::BoolLiteral; }
     virtual ~ex_BoolLiteralNode() noexcept = default;
 };
 
 class ex_IdentifierNode : public ExpressionNode {
   public:
-    std::string name;
-    ex_IdentifierNode(const std::string &name);
+    const Symbol name;
+    ex_IdentifierNode(Symbol name);
     void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::Identifier; }
 };
 
 } // namespace umbra
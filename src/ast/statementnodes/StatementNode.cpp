@@ -1,16 +1,29 @@
 #include "StatementNode.h"
+#include "../ExternalASTSource.h"
 #include "../visitor/ASTVisitor.h"
-#include <memory>
-#include <string>
 
 namespace umbra {
 
-st_VariableDeclNode::st_VariableDeclNode(TokenType type, const std::string &name,
-                                         std::unique_ptr<ExpressionNode> initializer = nullptr,
-                                         std::unique_ptr<ExpressionNode> arraySize = nullptr)
-    : type(type), name(name), initializer(std::move(initializer)), arraySize(std::move(arraySize)) {
-}
+st_VariableDeclNode::st_VariableDeclNode(TokenType type, Symbol name,
+                                         ExpressionNode *initializer = nullptr,
+                                         ExpressionNode *arraySize = nullptr)
+    : StatementNode(Kind::VariableDecl), type(type), name(name), initializer(initializer),
+      arraySize(arraySize) {}
 
 void st_VariableDeclNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
 
+void ParameterNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
+
+void ReturnStatementNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
+
+void FunctionDeclNode::accept(ASTVisitor &visitor) { visitor.visit(*this); }
+
+void FunctionDeclNode::readLazyBody() const {
+    // The source stays attached if reading throws, so the next access retries
+    FunctionBody loaded = bodySource->readFunctionBody(bodyOffset);
+    body = loaded.statements;
+    returnStmt = loaded.returnStmt;
+    bodySource = nullptr;
+}
+
 } // namespace umbra
\ No newline at end of file
@@ -5,86 +5,124 @@
 #include "../ASTNode.h"
 #include "../expressionnodes/ExpressionNode.h"
 #include "../visitor/ASTVisitor.h"
-#include <iostream>
-#include <memory>
-#include <vector>
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/Support/Compiler.h>
+#include <cstdint>
+#include <string_view>
 
 namespace umbra {
 
 class ExpressionNode;
+class ExternalASTSource;
 
 class StatementNode : public ASTNode {
   public:
+    explicit StatementNode(Kind kind) : ASTNode(kind) {}
     void accept(ASTVisitor &visitor) = 0;
+    static bool classof(const ASTNode *node) {
+        return node->getKind() >= Kind::FirstStatement && node->getKind() <= Kind::LastStatement;
+    }
     virtual ~StatementNode() noexcept = default;
 };
 
 class st_VariableDeclNode : public StatementNode {
   public:
-    st_VariableDeclNode(TokenType type, const std::string &name,
-                        std::unique_ptr<ExpressionNode> initializer,
-                        std::unique_ptr<ExpressionNode> arraySize);
+    st_VariableDeclNode(TokenType type, Symbol name, ExpressionNode *initializer,
+                        ExpressionNode *arraySize);
 
     TokenType getType() const { return type; }
-    const std::string &getName() const { return name; }
-    ExpressionNode *getInitializer() const { return initializer.get(); }
-    ExpressionNode *getArraySize() const { return arraySize.get(); }
+    Symbol getName() const { return name; }
+    ExpressionNode *getInitializer() const { return initializer; }
+    ExpressionNode *getArraySize() const { return arraySize; }
 
     void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::VariableDecl; }
 
     ~st_VariableDeclNode() noexcept override = default;
 
   private:
     TokenType type;
-    std::string name;
-    std::unique_ptr<ExpressionNode> initializer;
-    std::unique_ptr<ExpressionNode> arraySize;
+    Symbol name;
+    ExpressionNode *initializer;
+    ExpressionNode *arraySize;
 };
 
 class ParameterNode : public ASTNode {
   public:
-    ParameterNode(TokenType type, const std::string &name) : type(type), name(name) {}
+    ParameterNode(TokenType type, Symbol name)
+        : ASTNode(Kind::Parameter), type(type), name(name) {}
 
     TokenType getType() const { return type; }
-    const std::string &getName() const { return name; }
-    void accept(ASTVisitor &visitor) = 0;
+    Symbol getName() const { return name; }
+    void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::Parameter; }
 
   private:
     TokenType type;
-    std::string name;
+    Symbol name;
 };
 
 class ReturnStatementNode : public StatementNode {
   public:
-    ReturnStatementNode(std::unique_ptr<ExpressionNode> returnValue)
-        : returnValue(std::move(returnValue)) {}
+    ReturnStatementNode(ExpressionNode *returnValue)
+        : StatementNode(Kind::ReturnStatement), returnValue(returnValue) {}
 
-    const ExpressionNode *getReturnValue() const { return returnValue.get(); }
-    void accept(ASTVisitor &visitor) = 0;
+    ExpressionNode *getReturnValue() const { return returnValue; }
+    void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::ReturnStatement; }
 
     ~ReturnStatementNode() noexcept override = default;
 
   private:
-    std::unique_ptr<ExpressionNode> returnValue;
+    ExpressionNode *returnValue;
 };
 
 class FunctionDeclNode : public StatementNode {
   public:
-    FunctionDeclNode(std::string name, std::vector<std::unique_ptr<ParameterNode>> params,
-                     TokenType returnType, std::vector<std::unique_ptr<ASTNode>> body,
-                     std::unique_ptr<ReturnStatementNode> returnStmt)
-        : name(std::move(name)), params(std::move(params)), returnType(returnType),
-          body(std::move(body)), returnStmt(std::move(returnStmt)) {}
+    FunctionDeclNode(Symbol name, llvm::ArrayRef<ParameterNode *> params, TokenType returnType,
+                     llvm::ArrayRef<ASTNode *> body, ReturnStatementNode *returnStmt)
+        : StatementNode(Kind::FunctionDecl), name(name), params(params), returnType(returnType),
+          body(body), returnStmt(returnStmt) {}
+
+    Symbol getName() const { return name; }
+    llvm::ArrayRef<ParameterNode *> getParams() const { return params; }
+    TokenType getReturnType() const { return returnType; }
+    llvm::ArrayRef<ASTNode *> getBody() const {
+        loadBody();
+        return body;
+    }
+    ReturnStatementNode *getReturnStmt() const {
+        loadBody();
+        return returnStmt;
+    }
+
+    // Leaves the body (statements and return statement) in `source` until it
+    // is first asked for. Loading is not synchronized, so a tree with lazy
+    // bodies must be used from one thread at a time.
+    void setLazyBody(ExternalASTSource *source, uint64_t offset) {
+        bodySource = source;
+        bodyOffset = offset;
+    }
+    bool isBodyLoaded() const { return bodySource == nullptr; }
 
-    void accept(ASTVisitor &visitor) = 0;
+    void accept(ASTVisitor &visitor);
+    static bool classof(const ASTNode *node) { return node->getKind() == Kind::FunctionDecl; }
     ~FunctionDeclNode() noexcept override = default;
 
   private:
-    std::string name;
-    std::vector<std::unique_ptr<ParameterNode>> params;
+    void loadBody() const {
+        if (LLVM_UNLIKELY(bodySource != nullptr))
+            readLazyBody();
+    }
+    void readLazyBody() const;
+
+    Symbol name;
+    llvm::ArrayRef<ParameterNode *> params;
     TokenType returnType;
-    std::vector<std::unique_ptr<ASTNode>> body;
-    std::unique_ptr<ReturnStatementNode> returnStmt;
+    mutable llvm::ArrayRef<ASTNode *> body;
+    mutable ReturnStatementNode *returnStmt;
+    mutable ExternalASTSource *bodySource = nullptr;
+    uint64_t bodyOffset = 0;
 };
 
 } // namespace umbra
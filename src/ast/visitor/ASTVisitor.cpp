@@ -1,17 +1,17 @@
 #include "ASTVisitor.h"
 #include "../../lexer/Tokens.h"
 #include "../statementnodes/StatementNode.h"
-#include <iostream>
+#include <llvm/Support/Format.h>
 
 namespace umbra {
 
-PrintVisitor::PrintVisitor() : indentLevel(0) {}
+PrintVisitor::PrintVisitor(llvm::raw_ostream &os) : os(os), indentLevel(0) {}
 
 PrintVisitor::~PrintVisitor() = default;
 
 void PrintVisitor::visit(ProgramNode &node) {
     printIndent();
-    std::cout << "ProgramNode:" << std::endl;
+    os << "ProgramNode:\n";
     increaseIndent();
 
     for (const auto &statement : node.getStatements()) {
@@ -26,18 +26,18 @@ void PrintVisitor::visit(ProgramNode &node) {
 // statements
 void PrintVisitor::visit(st_VariableDeclNode &node) {
     printIndent();
-    std::cout << "VariableDeclaration:" << std::endl;
+    os << "VariableDeclaration:\n";
     increaseIndent();
 
     printIndent();
-    std::cout << "Type: " << TokenManager::tokenTypeToString(node.getType()) << std::endl;
+    os << "Type: " << TokenManager::tokenTypeToString(node.getType()) << '\n';
 
     printIndent();
-    std::cout << "Name: " << node.getName() << std::endl;
+    os << "Name: " << node.getName() << '\n';
 
     if (node.getArraySize()) {
         printIndent();
-        std::cout << "Array Size: " << std::endl;
+        os << "Array Size: \n";
         increaseIndent();
         node.getArraySize()->accept(*this);
         decreaseIndent();
@@ -45,7 +45,7 @@ void PrintVisitor::visit(st_VariableDeclNode &node) {
 
     if (node.getInitializer()) {
         printIndent();
-        std::cout << "Initializer: " << std::endl;
+        os << "Initializer: \n";
         increaseIndent();
         node.getInitializer()->accept(*this);
         decreaseIndent();
@@ -54,46 +54,92 @@ void PrintVisitor::visit(st_VariableDeclNode &node) {
     decreaseIndent();
 }
 
+void PrintVisitor::visit(ParameterNode &node) {
+    printIndent();
+    os << "Parameter: " << TokenManager::tokenTypeToString(node.getType()) << ' '
+       << node.getName() << '\n';
+}
+
+void PrintVisitor::visit(ReturnStatementNode &node) {
+    printIndent();
+    os << "ReturnStatement:\n";
+    if (node.getReturnValue()) {
+        increaseIndent();
+        node.getReturnValue()->accept(*this);
+        decreaseIndent();
+    }
+}
+
+void PrintVisitor::visit(FunctionDeclNode &node) {
+    printIndent();
+    os << "FunctionDeclaration:\n";
+    increaseIndent();
+
+    printIndent();
+    os << "Name: " << node.getName() << '\n';
+
+    printIndent();
+    os << "Return Type: " << TokenManager::tokenTypeToString(node.getReturnType()) << '\n';
+
+    printIndent();
+    os << "Parameters: \n";
+    increaseIndent();
+    for (ParameterNode *parameter : node.getParams())
+        parameter->accept(*this);
+    decreaseIndent();
+
+    printIndent();
+    os << "Body: \n";
+    increaseIndent();
+    for (ASTNode *statement : node.getBody()) {
+        if (statement)
+            statement->accept(*this);
+    }
+    if (node.getReturnStmt())
+        node.getReturnStmt()->accept(*this);
+    decreaseIndent();
+
+    decreaseIndent();
+}
+
 // expressions
 
 void PrintVisitor::visit(ex_IntegerLiteralNode &node) {
     printIndent();
-    std::cout << "IntegerLiteral: " << node.value << std::endl;
+    os << "IntegerLiteral: " << node.value << '\n';
 }
 
 void PrintVisitor::visit(ex_FloatLiteralNode &node) {
     printIndent();
-    std::cout << "FloatLiteral: " << node.value << std::endl;
+    os << "FloatLiteral: " << llvm::format("%g", node.value) << '\n';
 }
 
 void PrintVisitor::visit(ex_StringLiteralNode &node) {
     printIndent();
-    std::cout << "StringLiteral: \"" << node.value << "\"" << std::endl;
+    os << "StringLiteral: \"" << llvm::StringRef(node.value.data(), node.value.size())
+       << "\"\n";
 }
 
 void PrintVisitor::visit(ex_CharLiteralNode &node) {
     printIndent();
-    std::cout << "CharLiteral: \"" << node.value << "\"" << std::endl;
+    os << "CharLiteral: \"" << llvm::StringRef(node.value.data(), node.value.size())
+       << "\"\n";
 }
 
 void PrintVisitor::visit(ex_BoolLiteralNode &node) {
     printIndent();
-    std::cout << "BooleanLiteral: " << (node.value ? "true" : "false") << std::endl;
+    os << "BooleanLiteral: " << (node.value ? "true" : "false") << '\n';
 }
 
 void PrintVisitor::visit(ex_IdentifierNode &node) {
     printIndent();
-    std::cout << "IdentifierNode: " << node.name << std::endl;
+    os << "IdentifierNode: " << node.name << '\n';
 }
 
 void PrintVisitor::increaseIndent() { ++indentLevel; }
 
 void PrintVisitor::decreaseIndent() { --indentLevel; }
 
-void PrintVisitor::printIndent() {
-    for (int i = 0; i < indentLevel; ++i) {
-        std::cout << "    ";
-    }
-}
+void PrintVisitor::printIndent() { os.indent(indentLevel * 4); }
 
 } // namespace umbra
\ No newline at end of file
@@ -4,10 +4,14 @@
 #include "../ProgramNode.h"
 #include "../expressionnodes/ExpressionNode.h"
 #include "../statementnodes/StatementNode.h"
+#include <llvm/Support/raw_ostream.h>
 
 namespace umbra {
 
 class st_VariableDeclNode;
+class ParameterNode;
+class ReturnStatementNode;
+class FunctionDeclNode;
 
 class ASTVisitor {
   public:
@@ -17,6 +21,9 @@ class ASTVisitor {
 
     // statements
     virtual void visit(st_VariableDeclNode &node) = 0;
+    virtual void visit(ParameterNode &node) = 0;
+    virtual void visit(ReturnStatementNode &node) = 0;
+    virtual void visit(FunctionDeclNode &node) = 0;
 
     // expressions
     virtual void visit(ex_IntegerLiteralNode &node) = 0;
@@ -29,13 +36,17 @@ class ASTVisitor {
 
 class PrintVisitor : public ASTVisitor {
   public:
-    PrintVisitor();
+    // Writes to stdout through LLVM's buffered stream by default
+    explicit PrintVisitor(llvm::raw_ostream &os = llvm::outs());
     ~PrintVisitor() override;
 
     void visit(ProgramNode &node) override;
 
     // statements
     void visit(st_VariableDeclNode &node) override;
+    void visit(ParameterNode &node) override;
+    void visit(ReturnStatementNode &node) override;
+    void visit(FunctionDeclNode &node) override;
 
     // expressions
     void visit(ex_IntegerLiteralNode &node) override;
@@ -48,6 +59,7 @@ class PrintVisitor : public ASTVisitor {
     // Implement
 
   private:
+    llvm::raw_ostream &os;
     int indentLevel;
     void printIndent();
     void increaseIndent();
@@ -0,0 +1,136 @@
+#ifndef RECURSIVE_AST_VISITOR_H
+#define RECURSIVE_AST_VISITOR_H
+
+#include "../ProgramNode.h"
+#include "../expressionnodes/ExpressionNode.h"
+#include "../statementnodes/StatementNode.h"
+#include <llvm/Support/Casting.h>
+
+namespace umbra {
+
+// Statically dispatched alternative to ASTVisitor. A pass derives from
+// RecursiveASTVisitor<Pass> and hides the hooks it cares about:
+//
+//   class CountLiterals : public RecursiveASTVisitor<CountLiterals> {
+//     public:
+//       bool visitIntegerLiteral(ex_IntegerLiteralNode *) { ++count; return true; }
+//       size_t count = 0;
+//   };
+//   CountLiterals().traverse(program);
+//
+// traverse() calls Derived::visitNode, then switches on the node's Kind:
+// leaves go straight to Derived::visitX, and nodes with children to
+// Derived::traverseX, which calls visitX and then traverses the children in
+// source order. Every call is resolved at compile time, so a pass inlines
+// into a single loop with no virtual calls. Returning false from any hook
+// stops the whole traversal. Null children are skipped.
+template <typename Derived> class RecursiveASTVisitor {
+  public:
+    Derived &getDerived() { return *static_cast<Derived *>(this); }
+
+    bool traverse(ASTNode *node) {
+        if (!node)
+            return true;
+        if (auto *expression = llvm::dyn_cast<ExpressionNode>(node))
+            return getDerived().traverseExpression(expression);
+        if (!getDerived().visitNode(node))
+            return false;
+        switch (node->getKind()) {
+        case ASTNode::Kind::Program:
+            return getDerived().traverseProgram(llvm::cast<ProgramNode>(node));
+        case ASTNode::Kind::Parameter:
+            return getDerived().traverseParameter(llvm::cast<ParameterNode>(node));
+        case ASTNode::Kind::VariableDecl:
+            return getDerived().traverseVariableDecl(llvm::cast<st_VariableDeclNode>(node));
+        case ASTNode::Kind::ReturnStatement:
+            return getDerived().traverseReturnStatement(llvm::cast<ReturnStatementNode>(node));
+        case ASTNode::Kind::FunctionDecl:
+            return getDerived().traverseFunctionDecl(llvm::cast<FunctionDeclNode>(node));
+        default:
+            return true;
+        }
+    }
+
+    // Expressions are leaves, so this does not recurse and inlines into each
+    // parent's traversal. Every child position then gets its own copy of the
+    // switch, whose branch predicts far better than one shared by all nodes.
+    bool traverseExpression(ExpressionNode *node) {
+        if (!node)
+            return true;
+        if (!getDerived().visitNode(node))
+            return false;
+        switch (node->getKind()) {
+        case ASTNode::Kind::IntegerLiteral:
+            return getDerived().visitIntegerLiteral(llvm::cast<ex_IntegerLiteralNode>(node));
+        case ASTNode::Kind::FloatLiteral:
+            return getDerived().visitFloatLiteral(llvm::cast<ex_FloatLiteralNode>(node));
+        case ASTNode::Kind::StringLiteral:
+            return getDerived().visitStringLiteral(llvm::cast<ex_StringLiteralNode>(node));
+        case ASTNode::Kind::CharLiteral:
+            return getDerived().visitCharLiteral(llvm::cast<ex_CharLiteralNode>(node));
+        case ASTNode::Kind::BoolLiteral:
+            return getDerived().visitBoolLiteral(llvm::cast<ex_BoolLiteralNode>(node));
+        case ASTNode::Kind::Identifier:
+            return getDerived().visitIdentifier(llvm::cast<ex_IdentifierNode>(node));
+        default:
+            return true;
+        }
+    }
+
+    // Traversal of nodes with children
+    bool traverseProgram(ProgramNode *node) {
+        if (!getDerived().visitProgram(node))
+            return false;
+        for (ASTNode *statement : node->getStatements()) {
+            if (!getDerived().traverse(statement))
+                return false;
+        }
+        return true;
+    }
+
+    bool traverseParameter(ParameterNode *node) { return getDerived().visitParameter(node); }
+
+    bool traverseVariableDecl(st_VariableDeclNode *node) {
+        return getDerived().visitVariableDecl(node) &&
+               getDerived().traverseExpression(node->getArraySize()) &&
+               getDerived().traverseExpression(node->getInitializer());
+    }
+
+    bool traverseReturnStatement(ReturnStatementNode *node) {
+        return getDerived().visitReturnStatement(node) &&
+               getDerived().traverseExpression(node->getReturnValue());
+    }
+
+    bool traverseFunctionDecl(FunctionDeclNode *node) {
+        if (!getDerived().visitFunctionDecl(node))
+            return false;
+        for (ParameterNode *parameter : node->getParams()) {
+            if (!getDerived().traverse(parameter))
+                return false;
+        }
+        for (ASTNode *statement : node->getBody()) {
+            if (!getDerived().traverse(statement))
+                return false;
+        }
+        return getDerived().traverse(node->getReturnStmt());
+    }
+
+    // Per-node hooks; the defaults do nothing and continue. visitNode() runs
+    // first for every node, before the hook of its kind.
+    bool visitNode(ASTNode *) { return true; }
+    bool visitProgram(ProgramNode *) { return true; }
+    bool visitParameter(ParameterNode *) { return true; }
+    bool visitVariableDecl(st_VariableDeclNode *) { return true; }
+    bool visitReturnStatement(ReturnStatementNode *) { return true; }
+    bool visitFunctionDecl(FunctionDeclNode *) { return true; }
+    bool visitIntegerLiteral(ex_IntegerLiteralNode *) { return true; }
+    bool visitFloatLiteral(ex_FloatLiteralNode *) { return true; }
+    bool visitStringLiteral(ex_StringLiteralNode *) { return true; }
+    bool visitCharLiteral(ex_CharLiteralNode *) { return true; }
+    bool visitBoolLiteral(ex_BoolLiteralNode *) { return true; }
+    bool visitIdentifier(ex_IdentifierNode *) { return true; }
+};
+
+} // namespace umbra
+
+#endif // RECURSIVE_AST_VISITOR_H
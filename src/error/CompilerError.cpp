@@ -3,10 +3,14 @@
 
 namespace umbra {
 
-std::string CompilerError::toString() const {
+std::string CompilerError::toString(const PresumedLoc &position) const {
     std::ostringstream oss;
     oss << "\033[31m" // Iniciar color rojo
-        << getErrorTypeString() << " error at line " << line << ", column " << column << ": "
+        << getErrorTypeString() << " error";
+    if (!position.filename.empty())
+        oss << " in " << position.filename;
+    oss << " at line " << position.line << ", column "
+        << position.column << ": "
         << "\033[0m" // Restablecer color
         << message;
     return oss.str();
@@ -25,9 +29,9 @@ std::string CompilerError::getErrorTypeString() const {
     }
 }
 
-std::string LexicalError::toString() const {
+std::string LexicalError::toString(const PresumedLoc &position) const {
     std::ostringstream oss;
-    oss << CompilerError::toString() << " ('" << problematic_char << "')";
+    oss << CompilerError::toString(position) << " ('" << problematic_char << "')";
     return oss.str();
 }
 
@@ -1,39 +1,41 @@
 #ifndef UMBRA_COMPILER_ERROR_H
 #define UMBRA_COMPILER_ERROR_H
 
+#include "../lexer/SourceManager.h"
 #include "ErrorTypes.h"
+#include <cstdint>
 #include <string>
 
 namespace umbra {
 
 class CompilerError {
   public:
-    CompilerError(ErrorType type, const std::string &message, int line, int column)
-        : type(type), message(message), line(line), column(column) {}
+    // Errors only record a SourceLocation; the ErrorManager resolves it to a
+    // file, line and column when the report is printed.
+    CompilerError(ErrorType type, std::string message, SourceLocation location)
+        : type(type), message(std::move(message)), location(location) {}
 
     virtual ~CompilerError() = default;
 
-    virtual std::string toString() const;
+    virtual std::string toString(const PresumedLoc &position) const;
     ErrorType getType() const { return type; }
-    int getLine() const { return line; }
-    int getColumn() const { return column; }
+    SourceLocation getLocation() const { return location; }
 
   protected:
     std::string getErrorTypeString() const;
 
     ErrorType type;
     std::string message;
-    int line;
-    int column;
+    SourceLocation location;
 };
 
 class LexicalError : public CompilerError {
   public:
-    LexicalError(const std::string &message, int line, int column, char problematic_char)
-        : CompilerError(ErrorType::LEXICAL, message, line, column),
+    LexicalError(std::string message, SourceLocation location, char problematic_char)
+        : CompilerError(ErrorType::LEXICAL, std::move(message), location),
           problematic_char(problematic_char) {}
 
-    std::string toString() const override;
+    std::string toString(const PresumedLoc &position) const override;
 
   private:
     char problematic_char;
@@ -5,6 +5,7 @@
 namespace umbra {
 
 void ErrorManager::addError(std::unique_ptr<CompilerError> error) {
+    std::lock_guard<std::mutex> lock(mutex);
     if (errors.size() < MAX_ERRORS) {
         errors.push_back(std::move(error));
     } else {
@@ -12,32 +13,58 @@ void ErrorManager::addError(std::unique_ptr<CompilerError> error) {
     }
 }
 
-bool ErrorManager::hasErrors() const { return !errors.empty(); }
+bool ErrorManager::hasErrors() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return !errors.empty();
+}
 
 std::string ErrorManager::getErrorReport() const {
+    std::lock_guard<std::mutex> lock(mutex);
     std::ostringstream report;
     for (const auto &error : errors) {
-        report << error->toString() << "\n";
+        report << error->toString(getPresumedLoc(*error)) << "\n";
     }
     return report.str();
 }
 
-size_t ErrorManager::getErrorCount() const { return errors.size(); }
+size_t ErrorManager::getErrorCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return errors.size();
+}
 
-void ErrorManager::clear() { errors.clear(); }
+void ErrorManager::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    errors.clear();
+}
 
 const std::vector<std::unique_ptr<CompilerError>> &ErrorManager::getErrors() const {
     return errors;
 }
 
+std::vector<std::unique_ptr<CompilerError>> ErrorManager::takeErrors() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::unique_ptr<CompilerError>> taken = std::move(errors);
+    errors.clear();
+    return taken;
+}
+
 void ErrorManager::sortErrors() {
-    std::sort(errors.begin(), errors.end(),
-              [](const std::unique_ptr<CompilerError> &a, const std::unique_ptr<CompilerError> &b) {
-                  if (a->getLine() != b->getLine()) {
-                      return a->getLine() < b->getLine();
-                  }
-                  return a->getColumn() < b->getColumn();
-              });
+    std::lock_guard<std::mutex> lock(mutex);
+    std::stable_sort(
+        errors.begin(), errors.end(),
+        [](const std::unique_ptr<CompilerError> &a, const std::unique_ptr<CompilerError> &b) {
+            return a->getLocation() < b->getLocation();
+        });
+}
+
+PresumedLoc ErrorManager::getPresumedLoc(const CompilerError &error) const {
+    SourceLocation location = error.getLocation();
+    if (sourceManager)
+        return sourceManager->getPresumedLoc(location);
+    if (!sourceBuffer || !sourceBuffer->contains(location))
+        return {std::string_view(), 0, static_cast<int>(location.getRawEncoding())};
+    LineColumn position = sourceBuffer->getLineColumn(sourceBuffer->getOffset(location));
+    return {std::string_view(), position.line, position.column};
 }
 
 } // namespace umbra
\ No newline at end of file
@@ -3,11 +3,15 @@
 
 #include "CompilerError.h"
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 namespace umbra {
 
+// Reports may come from several threads at once (the pipelined lexer and the
+// parser share one manager); every member is serialized except getErrors(),
+// whose result is only stable once those threads are done.
 class ErrorManager {
   public:
     void addError(std::unique_ptr<CompilerError> error);
@@ -16,10 +20,21 @@ class ErrorManager {
     size_t getErrorCount() const;
     void clear();
     const std::vector<std::unique_ptr<CompilerError>> &getErrors() const;
+    // Moves all errors out, leaving the manager empty
+    std::vector<std::unique_ptr<CompilerError>> takeErrors();
     void sortErrors();
+    // Error locations are resolved through the SourceManager when one is set
+    // (multi-file compilations, reports name the file), otherwise against the
+    // single buffer being compiled.
+    void setSourceManager(const SourceManager *manager) { sourceManager = manager; }
+    void setSourceBuffer(const SourceBuffer *buffer) { sourceBuffer = buffer; }
+    PresumedLoc getPresumedLoc(const CompilerError &error) const;
 
   private:
+    const SourceManager *sourceManager = nullptr;
+    const SourceBuffer *sourceBuffer = nullptr;
     static const size_t MAX_ERRORS = 100;
+    mutable std::mutex mutex;
     std::vector<std::unique_ptr<CompilerError>> errors;
 };
 
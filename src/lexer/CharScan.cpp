@@ -0,0 +1,499 @@
+#include "CharScan.h"
+#include <llvm/Support/Compiler.h>
+#include <atomic>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define UMBRA_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if UMBRA_HAVE_SSE2 && (defined(__GNUC__) || defined(__clang__))
+#define UMBRA_HAVE_AVX2 1
+#define UMBRA_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace umbra {
+namespace charscan {
+
+namespace {
+
+inline unsigned firstSetBit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+inline unsigned popCount(unsigned mask) {
+#ifdef _MSC_VER
+    return static_cast<unsigned>(__popcnt(mask));
+#else
+    return static_cast<unsigned>(__builtin_popcount(mask));
+#endif
+}
+
+/* Scalar */
+
+inline bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+inline bool isDigitChar(char c) { return c >= '0' && c <= '9'; }
+inline bool isBlankChar(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+const char *skipIdentifierScalar(const char *p, const char *end) {
+    while (p < end && isIdentifierChar(*p))
+        ++p;
+    return p;
+}
+
+const char *skipDigitsScalar(const char *p, const char *end) {
+    while (p < end && isDigitChar(*p))
+        ++p;
+    return p;
+}
+
+const char *skipBlanksScalar(const char *p, const char *end) {
+    while (p < end && isBlankChar(*p))
+        ++p;
+    return p;
+}
+
+size_t countNewlinesScalar(const char *p, const char *end) {
+    size_t count = 0;
+    for (; p < end; ++p)
+        count += *p == '\n';
+    return count;
+}
+
+// Length of the well-formed UTF-8 sequence at p, or 0
+size_t utf8SequenceLength(const char *p, const char *end) {
+    const unsigned char *s = reinterpret_cast<const unsigned char *>(p);
+    unsigned char lead = s[0];
+    if (lead < 0x80)
+        return 1;
+    size_t length;
+    unsigned char min = 0x80, max = 0xBF; // bounds of the second byte
+    if (lead >= 0xC2 && lead <= 0xDF) {
+        length = 2;
+    } else if (lead >= 0xE0 && lead <= 0xEF) {
+        length = 3;
+        if (lead == 0xE0)
+            min = 0xA0; // overlong
+        else if (lead == 0xED)
+            max = 0x9F; // surrogates
+    } else if (lead >= 0xF0 && lead <= 0xF4) {
+        length = 4;
+        if (lead == 0xF0)
+            min = 0x90; // overlong
+        else if (lead == 0xF4)
+            max = 0x8F; // above U+10FFFF
+    } else {
+        return 0;
+    }
+    if (end - p < static_cast<std::ptrdiff_t>(length) || s[1] < min || s[1] > max)
+        return 0;
+    for (size_t i = 2; i < length; ++i)
+        if ((s[i] & 0xC0) != 0x80)
+            return 0;
+    return length;
+}
+
+const char *findInvalidUtf8Scalar(const char *p, const char *end) {
+    while (p < end) {
+        size_t length = utf8SequenceLength(p, end);
+        if (!length)
+            return p;
+        p += length;
+    }
+    return end;
+}
+
+#if UMBRA_HAVE_SSE2
+
+/* SSE2: 16 bytes per step. Each class function returns 0xFF in the lanes that
+   belong to the class; unsigned range checks use the min_epu8 trick. */
+
+inline __m128i lanesAtMost16(__m128i x, char max) {
+    return _mm_cmpeq_epi8(_mm_min_epu8(x, _mm_set1_epi8(max)), x);
+}
+
+inline __m128i identifierLanes16(__m128i v) {
+    __m128i lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+    __m128i letter = lanesAtMost16(_mm_sub_epi8(lower, _mm_set1_epi8('a')), 'z' - 'a');
+    __m128i digit = lanesAtMost16(_mm_sub_epi8(v, _mm_set1_epi8('0')), 9);
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(letter, digit), underscore);
+}
+
+inline __m128i digitLanes16(__m128i v) {
+    return lanesAtMost16(_mm_sub_epi8(v, _mm_set1_epi8('0')), 9);
+}
+
+inline __m128i blankLanes16(__m128i v) {
+    return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                     _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                        _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+}
+
+inline __m128i load16(const char *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+const char *skipIdentifierSSE2(const char *p, const char *end) {
+    for (; end - p >= 16; p += 16) {
+        unsigned stop = ~_mm_movemask_epi8(identifierLanes16(load16(p))) & 0xFFFFu;
+        if (stop)
+            return p + firstSetBit(stop);
+    }
+    return skipIdentifierScalar(p, end);
+}
+
+const char *skipDigitsSSE2(const char *p, const char *end) {
+    for (; end - p >= 16; p += 16) {
+        unsigned stop = ~_mm_movemask_epi8(digitLanes16(load16(p))) & 0xFFFFu;
+        if (stop)
+            return p + firstSetBit(stop);
+    }
+    return skipDigitsScalar(p, end);
+}
+
+const char *skipBlanksSSE2(const char *p, const char *end) {
+    for (; end - p >= 16; p += 16) {
+        unsigned stop = ~_mm_movemask_epi8(blankLanes16(load16(p))) & 0xFFFFu;
+        if (stop)
+            return p + firstSetBit(stop);
+    }
+    return skipBlanksScalar(p, end);
+}
+
+// SSE2 has no byte shuffle, so only the ASCII test is vectorized: blocks with
+// a high bit set are decoded with the scalar validator.
+const char *findInvalidUtf8SSE2(const char *p, const char *end) {
+    while (end - p >= 16) {
+        if (!_mm_movemask_epi8(load16(p))) {
+            p += 16;
+            continue;
+        }
+        const char *blockEnd = p + 16;
+        while (p < blockEnd) {
+            size_t length = utf8SequenceLength(p, end);
+            if (!length)
+                return p;
+            p += length;
+        }
+    }
+    return findInvalidUtf8Scalar(p, end);
+}
+
+size_t countNewlinesSSE2(const char *p, const char *end) {
+    size_t count = 0;
+    for (; end - p >= 16; p += 16) {
+        unsigned hits = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(load16(p), _mm_set1_epi8('\n'))));
+        count += popCount(hits);
+    }
+    return count + countNewlinesScalar(p, end);
+}
+
+#endif // UMBRA_HAVE_SSE2
+
+#if UMBRA_HAVE_AVX2
+
+/* AVX2: same kernels, 32 bytes per step. */
+
+UMBRA_TARGET_AVX2 inline __m256i lanesAtMost32(__m256i x, char max) {
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(x, _mm256_set1_epi8(max)), x);
+}
+
+UMBRA_TARGET_AVX2 inline __m256i identifierLanes32(__m256i v) {
+    __m256i lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+    __m256i letter = lanesAtMost32(_mm256_sub_epi8(lower, _mm256_set1_epi8('a')), 'z' - 'a');
+    __m256i digit = lanesAtMost32(_mm256_sub_epi8(v, _mm256_set1_epi8('0')), 9);
+    __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(letter, digit), underscore);
+}
+
+UMBRA_TARGET_AVX2 inline __m256i digitLanes32(__m256i v) {
+    return lanesAtMost32(_mm256_sub_epi8(v, _mm256_set1_epi8('0')), 9);
+}
+
+UMBRA_TARGET_AVX2 inline __m256i blankLanes32(__m256i v) {
+    return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                           _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+}
+
+UMBRA_TARGET_AVX2 inline __m256i load32(const char *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+UMBRA_TARGET_AVX2 const char *skipIdentifierAVX2(const char *p, const char *end) {
+    for (; end - p >= 32; p += 32) {
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(identifierLanes32(load32(p))));
+        if (stop)
+            return p + firstSetBit(stop);
+    }
+    return skipIdentifierSSE2(p, end);
+}
+
+UMBRA_TARGET_AVX2 const char *skipDigitsAVX2(const char *p, const char *end) {
+    for (; end - p >= 32; p += 32) {
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(digitLanes32(load32(p))));
+        if (stop)
+            return p + firstSetBit(stop);
+    }
+    return skipDigitsSSE2(p, end);
+}
+
+UMBRA_TARGET_AVX2 const char *skipBlanksAVX2(const char *p, const char *end) {
+    for (; end - p >= 32; p += 32) {
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(blankLanes32(load32(p))));
+        if (stop)
+            return p + firstSetBit(stop);
+    }
+    return skipBlanksSSE2(p, end);
+}
+
+/* UTF-8 validation after Keiser and Lemire, "Validating UTF-8 in less than one
+   instruction per byte": three nibble lookups classify each (byte, previous
+   byte) pair into error bits, and the lengths of 3/4-byte sequences are checked
+   by comparing where continuations must and do appear. */
+
+constexpr uint8_t TOO_SHORT = 1 << 0;
+constexpr uint8_t TOO_LONG = 1 << 1;
+constexpr uint8_t OVERLONG_3 = 1 << 2;
+constexpr uint8_t TOO_LARGE = 1 << 3;
+constexpr uint8_t SURROGATE = 1 << 4;
+constexpr uint8_t OVERLONG_2 = 1 << 5;
+constexpr uint8_t TOO_LARGE_1000 = 1 << 6;
+constexpr uint8_t OVERLONG_4 = 1 << 6;
+constexpr uint8_t TWO_CONTS = 1 << 7;
+constexpr uint8_t CARRY = TOO_SHORT | TOO_LONG | TWO_CONTS;
+
+UMBRA_TARGET_AVX2 inline __m256i lookup16(__m256i indices, const uint8_t (&table)[16]) {
+    __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i *>(table));
+    return _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(half), indices);
+}
+
+UMBRA_TARGET_AVX2 inline __m256i highNibbles(__m256i v) {
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+// The 32 bytes ending N bytes before the end of `input`
+template <int N> UMBRA_TARGET_AVX2 inline __m256i previous(__m256i input, __m256i prevInput) {
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prevInput, input, 0x21), 16 - N);
+}
+
+UMBRA_TARGET_AVX2 __m256i utf8Errors(__m256i input, __m256i prevInput) {
+    static const uint8_t byte1High[16] = {
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS, TOO_SHORT | OVERLONG_2, TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE, TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4};
+    static const uint8_t byte1Low[16] = {
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, CARRY | OVERLONG_2, CARRY, CARRY,
+        CARRY | TOO_LARGE, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000};
+    static const uint8_t byte2High[16] = {
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE, TOO_SHORT, TOO_SHORT,
+        TOO_SHORT, TOO_SHORT};
+
+    __m256i prev1 = previous<1>(input, prevInput);
+    __m256i special =
+        _mm256_and_si256(_mm256_and_si256(lookup16(highNibbles(prev1), byte1High),
+                                          lookup16(_mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)),
+                                                   byte1Low)),
+                         lookup16(highNibbles(input), byte2High));
+
+    // 111_____ two bytes back or 1111____ three bytes back require a continuation
+    // (only those leads stay >= 0x80 after the saturating subtraction)
+    __m256i third = _mm256_subs_epu8(previous<2>(input, prevInput), _mm256_set1_epi8(0xE0 - 0x80));
+    __m256i fourth = _mm256_subs_epu8(previous<3>(input, prevInput), _mm256_set1_epi8(0xF0 - 0x80));
+    __m256i mustContinue =
+        _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(char(0x80)));
+    return _mm256_xor_si256(mustContinue, special);
+}
+
+// Non-zero where a sequence starting in the last three bytes is cut off
+UMBRA_TARGET_AVX2 inline __m256i utf8Incomplete(__m256i input) {
+    const __m256i max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, char(0xF0 - 1), char(0xE0 - 1), char(0xC0 - 1));
+    return _mm256_subs_epu8(input, max);
+}
+
+UMBRA_TARGET_AVX2 const char *findInvalidUtf8AVX2(const char *p, const char *end) {
+    const char *begin = p;
+    __m256i error = _mm256_setzero_si256();
+    __m256i prevInput = _mm256_setzero_si256();
+    __m256i prevIncomplete = _mm256_setzero_si256();
+    for (; end - p >= 32; p += 32) {
+        __m256i input = load32(p);
+        if (!_mm256_movemask_epi8(input)) {
+            // ASCII block: only a sequence cut off by the previous block can fail
+            error = _mm256_or_si256(error, prevIncomplete);
+        } else {
+            error = _mm256_or_si256(error, utf8Errors(input, prevInput));
+            prevIncomplete = utf8Incomplete(input);
+        }
+        prevInput = input;
+    }
+    // Locate the first bad byte with the scalar decoder (error path only)
+    if (!_mm256_testz_si256(error, error))
+        return findInvalidUtf8Scalar(begin, end);
+
+    // The tail restarts at the lead byte of any sequence that straddles it
+    const char *tail = p;
+    for (int back = 0; back < 3 && tail > begin && (uint8_t(tail[-1]) & 0xC0) == 0x80; ++back)
+        --tail;
+    if (tail > begin && uint8_t(tail[-1]) >= 0xC0)
+        --tail;
+    return findInvalidUtf8Scalar(tail, end);
+}
+
+UMBRA_TARGET_AVX2 size_t countNewlinesAVX2(const char *p, const char *end) {
+    size_t count = 0;
+    for (; end - p >= 32; p += 32) {
+        unsigned hits = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(load32(p), _mm256_set1_epi8('\n'))));
+        count += popCount(hits);
+    }
+    return count + countNewlinesSSE2(p, end);
+}
+
+#endif // UMBRA_HAVE_AVX2
+
+using ScanFn = const char *(*)(const char *, const char *);
+using CountFn = size_t (*)(const char *, const char *);
+
+struct Kernels {
+    Isa isa;
+    ScanFn identifier;
+    ScanFn digits;
+    ScanFn blanks;
+    CountFn newlines;
+    ScanFn utf8;
+};
+
+// Constant-initialized, so they are usable before any dynamic initializer runs
+#if UMBRA_HAVE_AVX2
+constexpr Kernels AVX2_KERNELS = {Isa::AVX2,     skipIdentifierAVX2, skipDigitsAVX2,
+                                  skipBlanksAVX2, countNewlinesAVX2,  findInvalidUtf8AVX2};
+#endif
+#if UMBRA_HAVE_SSE2
+constexpr Kernels SSE2_KERNELS = {Isa::SSE2,     skipIdentifierSSE2, skipDigitsSSE2,
+                                  skipBlanksSSE2, countNewlinesSSE2,  findInvalidUtf8SSE2};
+#endif
+constexpr Kernels SCALAR_KERNELS = {Isa::Scalar,     skipIdentifierScalar, skipDigitsScalar,
+                                    skipBlanksScalar, countNewlinesScalar,  findInvalidUtf8Scalar};
+
+const Kernels *kernelsFor(Isa isa) {
+    switch (isa) {
+#if UMBRA_HAVE_AVX2
+    case Isa::AVX2:
+        return &AVX2_KERNELS;
+#endif
+#if UMBRA_HAVE_SSE2
+    case Isa::SSE2:
+        return &SSE2_KERNELS;
+#endif
+    default:
+        return &SCALAR_KERNELS;
+    }
+}
+
+Isa bestIsa() {
+#if UMBRA_HAVE_AVX2
+    // The CPU model may not be initialized yet during static initialization
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return Isa::AVX2;
+#endif
+#if UMBRA_HAVE_SSE2
+    return Isa::SSE2;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+// Null until the first scan picks the best table. The tables are immutable,
+// so relaxed loads are enough, and setIsa() can switch while lexer threads
+// are scanning: each call runs entirely on one implementation.
+std::atomic<const Kernels *> active{nullptr};
+
+LLVM_ATTRIBUTE_NOINLINE const Kernels &selectKernels() {
+    static const Kernels *best = kernelsFor(bestIsa());
+    const Kernels *expected = nullptr;
+    active.compare_exchange_strong(expected, best, std::memory_order_relaxed);
+    return *active.load(std::memory_order_relaxed);
+}
+
+inline const Kernels &kernels() {
+    const Kernels *selected = active.load(std::memory_order_relaxed);
+    if (LLVM_LIKELY(selected))
+        return *selected;
+    return selectKernels();
+}
+
+} // namespace
+
+const char *skipIdentifierChars(const char *p, const char *end) {
+    return kernels().identifier(p, end);
+}
+
+const char *skipDigits(const char *p, const char *end) { return kernels().digits(p, end); }
+
+const char *skipBlanks(const char *p, const char *end) { return kernels().blanks(p, end); }
+
+size_t countNewlines(const char *p, const char *end) { return kernels().newlines(p, end); }
+
+const char *findInvalidUtf8(const char *p, const char *end) { return kernels().utf8(p, end); }
+
+const char *skipUtf8Char(const char *p, const char *end) {
+    size_t length = utf8SequenceLength(p, end);
+    return p + (length ? length : 1);
+}
+
+Isa activeIsa() { return kernels().isa; }
+
+bool isSupported(Isa isa) {
+    switch (isa) {
+    case Isa::Scalar:
+        return true;
+    case Isa::SSE2:
+#if UMBRA_HAVE_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case Isa::AVX2:
+        return bestIsa() == Isa::AVX2;
+    }
+    return false;
+}
+
+bool setIsa(Isa isa) {
+    if (!isSupported(isa))
+        return false;
+    active.store(kernelsFor(isa), std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace charscan
+} // namespace umbra
@@ -0,0 +1,48 @@
+#ifndef CHAR_SCAN_H
+#define CHAR_SCAN_H
+
+#include <cstddef>
+
+namespace umbra {
+
+// Bulk character-class scanners for the lexer's hot loops. The skip functions
+// return a pointer to the first byte in [p, end) that does not belong to the
+// scanned run (or end). None of them read past end, so they are safe on
+// memory-mapped buffers without a trailing '\0'.
+//
+// The implementation is picked on first use, so scans during static
+// initialization are safe: AVX2 (32 bytes per step) or
+// SSE2 (16 bytes per step) on x86, with a scalar fallback everywhere else.
+namespace charscan {
+
+enum class Isa { Scalar, SSE2, AVX2 };
+
+// [A-Za-z0-9_]
+const char *skipIdentifierChars(const char *p, const char *end);
+// [0-9]
+const char *skipDigits(const char *p, const char *end);
+// ' ', '\t', '\r' (newlines are significant and handled by the lexer)
+const char *skipBlanks(const char *p, const char *end);
+
+// Number of '\n' bytes in [p, end)
+size_t countNewlines(const char *p, const char *end);
+
+// First byte of [p, end) that is not part of well-formed UTF-8 (RFC 3629: no
+// overlongs, surrogates or code points above U+10FFFF), or end. Blocks with no
+// high bit set are skipped without decoding.
+const char *findInvalidUtf8(const char *p, const char *end);
+// End of the code point starting at p, or p + 1 if it is not valid UTF-8
+const char *skipUtf8Char(const char *p, const char *end);
+
+Isa activeIsa();
+bool isSupported(Isa isa);
+// Forces a specific implementation; returns false if the CPU lacks it. Safe
+// while other threads are scanning, though calls already running finish on
+// the previous implementation.
+bool setIsa(Isa isa);
+
+} // namespace charscan
+
+} // namespace umbra
+
+#endif // CHAR_SCAN_H
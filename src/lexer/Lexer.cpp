@@ -1,122 +1,239 @@
 #include "Lexer.h"
+#include "CharScan.h"
+#include "../support/Trace.h"
 #include "Tokens.h"
+#include <cassert>
 #include <cctype>
-#include <iostream>
+#include <charconv>
+#include <cstring>
 #include <stdexcept>
 #include <unordered_map>
 
 namespace umbra {
 
-Lexer::Lexer(const std::string &source)
-    : source(source), internalErrorManager(std::make_unique<ErrorManager>()),
-      errorManager(internalErrorManager.get()), current(0), line(1), column(1) {}
+Lexer::Lexer(const SourceBuffer &buffer)
+    : buffer(&buffer), source(buffer.getText()),
+      internalErrorManager(std::make_unique<ErrorManager>()),
+      errorManager(internalErrorManager.get()), current(0) {
+    errorManager->setSourceBuffer(&buffer);
+}
+
+Lexer::Lexer(const SourceBuffer &buffer, ErrorManager &externalErrorManager)
+    : buffer(&buffer), source(buffer.getText()), errorManager(&externalErrorManager), current(0) {
+    errorManager->setSourceBuffer(&buffer);
+}
 
-Lexer::Lexer(const std::string &source, ErrorManager &externalErrorManager)
-    : source(source), errorManager(&externalErrorManager), current(0), line(1), column(1) {}
+TokenBuffer Lexer::tokenize() {
+    TokenBuffer tokens(*buffer);
+    Token token;
+    do {
+        token = next();
+        tokens.push_back(token);
+    } while (token.type != TokenType::TOK_EOF);
+    return tokens;
+}
 
-std::vector<Lexer::Token> Lexer::tokenize() {
-    tokens.clear();
-    bool lastWasReturn = false;
+void Lexer::relex(TokenBuffer &tokens, const TextEdit &edit) {
+    assert(!tokens.empty() && tokens.kind(tokens.size() - 1) == TokenType::TOK_EOF &&
+           "relex needs a complete token stream");
+    const int64_t shift = static_cast<int64_t>(edit.text.size()) - edit.length;
+    const uint32_t oldEditEnd = edit.offset + edit.length;
+    const uint32_t newEditEnd = edit.offset + static_cast<uint32_t>(edit.text.size());
 
-    while (!isAtEnd()) {
-        start = current;
-        char c = advance();
+    // The last token starting before the edit may grow into it (e.g. "ab|" + "c"),
+    // so rescanning begins there. Anything before it is unaffected, and the
+    // lexer state at a token boundary can be recovered by seek().
+    size_t first = tokens.lowerBound(edit.offset);
+    uint32_t restart = 0;
+    if (first > 0)
+        restart = tokens.offset(--first);
+    seek(restart);
+    unterminatedAt = UINT32_MAX;
 
-        if (c == '\n') {
-            if (!lastWasReturn) {
-                addToken(TokenType::TOK_NEWLINE);
-                lastWasReturn = true;
+    // Once past the edit, a new token that matches an old one (same position
+    // after shifting, kind and length) means both streams agree from there on.
+    TokenBuffer fresh(*buffer);
+    size_t candidate = tokens.lowerBound(oldEditEnd);
+    size_t last = tokens.size();
+    bool synced = false;
+    Token token;
+    while (nextBefore(static_cast<uint32_t>(source.length()), token)) {
+        if (token.offset >= newEditEnd) {
+            uint32_t oldOffset = static_cast<uint32_t>(token.offset - shift);
+            while (candidate < tokens.size() && tokens.offset(candidate) < oldOffset)
+                candidate++;
+            if (candidate < tokens.size() && tokens.offset(candidate) == oldOffset &&
+                tokens.kind(candidate) == token.type &&
+                tokens.length(candidate) == token.lexeme.size()) {
+                last = candidate;
+                synced = true;
+                break;
             }
-            line++;
-            column = 1;
-            continue;
         }
-        lastWasReturn = false;
-        switch (c) {
-        case ' ':
-        case '\r':
-        case '\t':
-            // Ignorar espacios en blanco
-            break;
-        case '\'':
-            charliteral();
-            break;
-        case '"':
-            string();
-            break;
-        case '=':
-            addToken(TokenType::TOK_ASSIGN);
-            break;
-        case '-':
-            if (match('>'))
-                addToken(TokenType::TOK_ARROW);
-            else
-                addToken(TokenType::TOK_MINUS); // Usar como operador de resta
-            break;
-        case '+':
-            addToken(TokenType::TOK_ADD);
-            break;
-        case '*':
-            addToken(TokenType::TOK_MULT);
-            break;
-        case '(':
-            addToken(TokenType::TOK_LEFT_PAREN);
-            break;
-        case ')':
-            addToken(TokenType::TOK_RIGHT_PAREN);
-            break;
-        case '{':
-            addToken(TokenType::TOK_LEFT_BRACE);
-            break;
-        case '}':
-            addToken(TokenType::TOK_RIGHT_BRACE);
-            break;
-        case '[':
-            addToken(TokenType::TOK_LEFT_BRACKET);
-            break;
-        case ']':
-            addToken(TokenType::TOK_RIGHT_BRACKET);
-            break;
-        case ',':
-            addToken(TokenType::TOK_COMMA);
-            break;
-        case '.':
-            addToken(TokenType::TOK_DOT);
-            break;
-        default:
-            if (isDigit(c)) {
-                number();
-            } else if (isAlpha(c)) {
-                identifier();
-            } else {
-                std::string errorMsg = "Unexpected character: " + std::string(1, c);
-                errorManager->addError(
-                    std::make_unique<CompilerError>(ErrorType::LEXICAL, errorMsg, line, column));
-            }
-            break;
+        fresh.push_back(token);
+    }
+    if (!synced)
+        fresh.push_back(Token(TokenType::TOK_EOF, std::string_view(),
+                              static_cast<uint32_t>(source.length())));
+
+    tokens.splice(first, last, fresh, shift);
+    seek(static_cast<uint32_t>(source.length()));
+}
+
+Lexer::Token Lexer::next() {
+    if (lookaheadCount == 0)
+        return lexToken();
+    Token token = lookahead[lookaheadHead];
+    lookaheadHead = (lookaheadHead + 1) % MAX_LOOKAHEAD;
+    lookaheadCount--;
+    return token;
+}
+
+const Lexer::Token &Lexer::peek(size_t k) {
+    if (k >= MAX_LOOKAHEAD)
+        throw std::out_of_range("Lexer lookahead is limited to " + std::to_string(MAX_LOOKAHEAD) +
+                                " tokens");
+    while (lookaheadCount <= k) {
+        lookahead[(lookaheadHead + lookaheadCount) % MAX_LOOKAHEAD] = lexToken();
+        lookaheadCount++;
+    }
+    return lookahead[(lookaheadHead + k) % MAX_LOOKAHEAD];
+}
+
+Lexer::Token Lexer::lexToken() {
+    Token token;
+    if (nextBefore(static_cast<uint32_t>(source.length()), token))
+        return token;
+    return Token(TokenType::TOK_EOF, std::string_view(), static_cast<uint32_t>(source.length()));
+}
+
+// Scans the next token that starts before limit. A token that starts before
+// limit is always completed, even if it extends past it.
+bool Lexer::nextBefore(uint32_t limit, Token &token) {
+    while (!isAtEnd() && static_cast<uint32_t>(current) < limit) {
+        start = current;
+        if (scanToken()) {
+            token = scanned;
+            UMBRA_TRACE(Lexer, TokenManager::tokenTypeToString(token.type)
+                                   << " @" << token.offset << " '"
+                                   << trace::escaped(token.lexeme) << "'");
+            return true;
         }
     }
-    tokens.emplace_back(TokenType::TOK_EOF, "", line, column);
-    return tokens;
+    return false;
 }
 
-char Lexer::advance() {
-    column++;
-    return source[current++];
+// Restarts scanning at offset, which must not fall inside a token. The only
+// state carried between tokens is whether the last character consumed was a
+// newline, and that can be read back from the source.
+void Lexer::seek(uint32_t offset) {
+    lookaheadHead = 0;
+    lookaheadCount = 0;
+    current = static_cast<int>(offset);
+    start = current;
+    lastWasReturn = offset > 0 && source[offset - 1] == '\n';
 }
 
+// Consumes one character (plus whatever belongs to the same lexeme) and
+// reports whether a token was produced.
+bool Lexer::scanToken() {
+    emitted = false;
+    char c = advance();
+
+    if (c == '\n') {
+        if (!lastWasReturn) {
+            addToken(TokenType::TOK_NEWLINE);
+            lastWasReturn = true;
+        }
+        return emitted;
+    }
+    lastWasReturn = false;
+    switch (c) {
+    case ' ':
+    case '\r':
+    case '\t':
+        // Ignorar espacios en blanco (la racha completa de una vez)
+        advanceTo(charscan::skipBlanks(source.data() + current, source.data() + source.length()));
+        break;
+    case '\'':
+        charliteral();
+        break;
+    case '"':
+        string();
+        break;
+    case '=':
+        addToken(TokenType::TOK_ASSIGN);
+        break;
+    case '-':
+        if (match('>'))
+            addToken(TokenType::TOK_ARROW);
+        else
+            addToken(TokenType::TOK_MINUS); // Usar como operador de resta
+        break;
+    case '+':
+        addToken(TokenType::TOK_ADD);
+        break;
+    case '*':
+        addToken(TokenType::TOK_MULT);
+        break;
+    case '(':
+        addToken(TokenType::TOK_LEFT_PAREN);
+        break;
+    case ')':
+        addToken(TokenType::TOK_RIGHT_PAREN);
+        break;
+    case '{':
+        addToken(TokenType::TOK_LEFT_BRACE);
+        break;
+    case '}':
+        addToken(TokenType::TOK_RIGHT_BRACE);
+        break;
+    case '[':
+        addToken(TokenType::TOK_LEFT_BRACKET);
+        break;
+    case ']':
+        addToken(TokenType::TOK_RIGHT_BRACKET);
+        break;
+    case ',':
+        addToken(TokenType::TOK_COMMA);
+        break;
+    case '.':
+        addToken(TokenType::TOK_DOT);
+        break;
+    default:
+        if (isDigit(c)) {
+            number();
+        } else if (isAlpha(c)) {
+            identifier();
+        } else {
+            // Report a stray non-ASCII character once, not once per byte
+            const char *end = source.data() + source.length();
+            if (static_cast<unsigned char>(c) >= 0x80)
+                advanceTo(charscan::skipUtf8Char(source.data() + start, end));
+            addError("Unexpected character: " + std::string(source.substr(start, current - start)));
+        }
+        break;
+    }
+    return emitted;
+}
+
+char Lexer::advance() { return source[current++]; }
+
+// Consumes every character up to p in one step
+void Lexer::advanceTo(const char *p) { current = static_cast<int>(p - source.data()); }
+
 bool Lexer::isAtEnd() const {
-    return static_cast<std::string::size_type>(current) >= source.length();
+    return static_cast<std::string_view::size_type>(current) >= source.length();
 }
 
-char Lexer::peek() const {
+char Lexer::peekChar() const {
     if (isAtEnd())
         return '\0';
     return source[current];
 }
 
 char Lexer::peekNext() const {
-    if (static_cast<std::string::size_type>(current + 1) >= source.length())
+    if (static_cast<std::string_view::size_type>(current + 1) >= source.length())
         return '\0';
     return source[current + 1];
 }
@@ -127,87 +244,118 @@ bool Lexer::match(char expected) {
     if (source[current] != expected)
         return false;
     current++;
-    column++;
     return true;
 }
 
 void Lexer::addToken(TokenType type) { addToken(type, source.substr(start, current - start)); }
 
-void Lexer::addToken(TokenType type, const std::string &lexeme) {
-    tokens.emplace_back(type, lexeme, line, column - lexeme.length());
+void Lexer::addToken(TokenType type, std::string_view lexeme, TokenValue value, uint8_t flags) {
+    scanned = Token(type, lexeme, static_cast<uint32_t>(start), value, flags);
+    emitted = true;
+}
+
+// Lexical errors point at the start of the offending token
+void Lexer::addError(const std::string &message) {
+    errorManager->addError(
+        std::make_unique<CompilerError>(ErrorType::LEXICAL, message,
+                                        buffer->getLocation(static_cast<uint32_t>(start))));
 }
 
 void Lexer::charliteral() {
-    while (peek() != '\'' && !isAtEnd()) {
-        advance();
-    }
+    const char *quote = static_cast<const char *>(
+        std::memchr(source.data() + current, '\'', source.length() - current));
+    advanceTo(quote ? quote : source.data() + source.length());
     if (isAtEnd()) {
-        std::string errorMsg = "Unterminated char starting at line " + std::to_string(line) +
-                               ", column " + std::to_string(column);
-        errorManager->addError(
-            std::make_unique<CompilerError>(ErrorType::LEXICAL, errorMsg, line, column));
+        unterminatedAt = static_cast<uint32_t>(start);
+        addError("Unterminated char literal");
         return;
     }
     // get closing \'
     advance();
-    std::string value = source.substr(start + 1, current - start - 2); // clear \""
-    std::cout << "----->" << value << "<--";
+    std::string_view value = source.substr(start + 1, current - start - 2); // clear \""
+    checkUtf8(value, "char literal");
+    UMBRA_TRACE(Lexer, "char literal '" << trace::escaped(value) << "'");
 
     addToken(TokenType::TOK_CHAR_LITERAL, value);
 }
 
 void Lexer::string() {
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n')
-            line++;
-        advance();
-    }
+    const char *quote = static_cast<const char *>(
+        std::memchr(source.data() + current, '"', source.length() - current));
+    advanceTo(quote ? quote : source.data() + source.length());
 
     if (isAtEnd()) {
-        std::string errorMsg = "Unterminated string starting at line " + std::to_string(line) +
-                               ", column " + std::to_string(column);
-        errorManager->addError(
-            std::make_unique<CompilerError>(ErrorType::LEXICAL, errorMsg, line, column));
+        unterminatedAt = static_cast<uint32_t>(start);
+        addError("Unterminated string literal");
         return;
     }
 
     // get the closing ".
     advance();
 
-    std::string value = source.substr(start + 1, current - start - 2); // clear \""
+    std::string_view value = source.substr(start + 1, current - start - 2); // clear \""
+    checkUtf8(value, "string literal");
     addToken(TokenType::TOK_STRING_LITERAL, value);
 }
 
-void Lexer::number() {
+// Literal bodies may hold any UTF-8 text; the check is a bulk scan that skips
+// pure-ASCII blocks, so valid text costs little more than ASCII.
+void Lexer::checkUtf8(std::string_view body, const char *what) {
+    const char *end = body.data() + body.size();
+    if (charscan::findInvalidUtf8(body.data(), end) != end)
+        addError(std::string("Invalid UTF-8 in ") + what);
+}
 
-    while (isDigit(peek()))
-        advance();
+// Decodes the value while the digits are still hot in cache. Out-of-range
+// literals are diagnosed here and carry a zero value.
+void Lexer::number() {
+    const char *first = source.data() + start;
+    const char *end = source.data() + source.length();
+    advanceTo(charscan::skipDigits(source.data() + current, end));
+    const char *integerEnd = source.data() + current;
 
-    if (peek() == '.') {
+    bool isFloat = false;
+    if (peekChar() == '.') {
         if (!isDigit(peekNext())) {
-            std::string errorMsg = "Malformed number at line " + std::to_string(line) +
-                                   ", column " + std::to_string(column) +
-                                   ": expected digits after decimal point.";
-            errorManager->addError(
-                std::make_unique<CompilerError>(ErrorType::LEXICAL, errorMsg, line, column));
+            addError("Malformed number: expected digits after decimal point.");
             advance();
         } else {
             advance();
-            while (isDigit(peek()))
-                advance();
+            advanceTo(charscan::skipDigits(source.data() + current, end));
+            isFloat = true;
+        }
+    }
+
+    std::string_view text = source.substr(start, current - start);
+    if (isFloat) {
+        double real = 0.0;
+        auto result = std::from_chars(first, source.data() + current, real);
+        if (result.ec == std::errc::result_out_of_range) {
+            addError("Float literal out of range: " + std::string(text));
+            real = 0.0;
+        }
+        addToken(TokenType::TOK_NUMBER, text, TokenValue(real), TOKEN_FLAG_FLOAT);
+    } else {
+        int64_t integer = 0;
+        auto result = std::from_chars(first, integerEnd, integer);
+        if (result.ec == std::errc::result_out_of_range) {
+            addError("Integer literal out of range: " + std::string(text));
+            integer = 0;
         }
+        addToken(TokenType::TOK_NUMBER, text, TokenValue(integer));
     }
-    addToken(TokenType::TOK_NUMBER, source.substr(start, current - start));
 }
 
 void Lexer::identifier() {
-    while (isAlphaNumeric(peek()))
-        advance();
+    advanceTo(charscan::skipIdentifierChars(source.data() + current,
+                                            source.data() + source.length()));
 
-    std::string text = source.substr(start, current - start);
-    TokenType type = tokenManager.getKeywords().count(text) ? tokenManager.getKeywords().at(text)
-                                                            : TokenType::TOK_IDENTIFIER;
-    addToken(type, text);
+    std::string_view text = source.substr(start, current - start);
+    TokenType type = TokenManager::classifyIdentifier(text);
+    // Keywords are fully described by their type; only names get a symbol
+    addToken(type, text,
+             TokenValue(type == TokenType::TOK_IDENTIFIER ? SymbolTable::global().intern(text)
+                                                          : Symbol()));
 }
 
 bool Lexer::isAlpha(char c) const {
@@ -221,10 +369,8 @@ bool Lexer::isDigit(char c) const { return c >= '0' && c <= '9'; }
 bool Lexer::isWhitespace(char c) const { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
 
 void Lexer::reset() {
-    current = 0;
-    start = 0;
-    line = 1;
-    column = 1;
+    seek(0);
+    unterminatedAt = UINT32_MAX;
 }
 
 } // namespace umbra
\ No newline at end of file
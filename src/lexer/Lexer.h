@@ -2,60 +2,102 @@
 #define LEXER_H
 
 #include "../error/ErrorManager.h"
+#include "SourceBuffer.h"
+#include "TokenBuffer.h"
 #include "Tokens.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
 namespace umbra {
 
+// Replacement of the bytes [offset, offset + length) of a source by `text`
+struct TextEdit {
+    uint32_t offset;
+    uint32_t length;
+    std::string_view text;
+};
+
 class Lexer {
   public:
-    struct Token {
-        TokenType type;
-        std::string lexeme;
-        int line;
-        int column;
-
-        Token(TokenType t, std::string l, int ln, int col)
-            : type(t), lexeme(std::move(l)), line(ln), column(col) {}
-    };
+    using Token = umbra::Token;
     TokenManager tokenManager;
 
-    Lexer(const std::string &source);
-    Lexer(const std::string &source, ErrorManager &externalErrorManager);
-    std::vector<Token> tokenize();
+    // Tokens and diagnostics point into `buffer`, so it must outlive them;
+    // temporaries are rejected for that reason.
+    explicit Lexer(const SourceBuffer &buffer);
+    Lexer(const SourceBuffer &buffer, ErrorManager &externalErrorManager);
+    explicit Lexer(SourceBuffer &&) = delete;
+    Lexer(SourceBuffer &&, ErrorManager &) = delete;
+    // Pull-mode API: tokens are scanned on demand, at most MAX_LOOKAHEAD ahead of
+    // the consumer. Once the end is reached next() keeps returning TOK_EOF.
+    static constexpr size_t MAX_LOOKAHEAD = 4;
+    Token next();
+    const Token &peek(size_t k = 0);
+
+    // Drains the stream into a structure-of-arrays buffer; prefer next()/peek()
+    // when the tokens are consumed only once.
+    TokenBuffer tokenize();
+    // Incremental relexing: `tokens` was produced from the text before `edit`,
+    // and this lexer's buffer holds the text after it. Only the damaged region
+    // is rescanned, from the last token starting before the edit until the new
+    // tokens line up again with the old ones; the result is spliced into
+    // `tokens` and the offsets after it are shifted. Lexical errors are
+    // reported only for the rescanned region.
+    void relex(TokenBuffer &tokens, const TextEdit &edit);
     const ErrorManager &getErrorManager() const { return *errorManager; }
+    const SourceBuffer &getSourceBuffer() const { return *buffer; }
     void reset();
 
   private:
-    std::string source;
+    // Chunked lexing hooks for ParallelLexer
+    friend class ParallelLexer;
+    void seek(uint32_t offset);
+    bool nextBefore(uint32_t limit, Token &token);
+    uint32_t position() const { return static_cast<uint32_t>(current); }
+
+    const SourceBuffer *buffer;
+    std::string_view source;
     std::unique_ptr<ErrorManager> internalErrorManager;
     ErrorManager *errorManager;
-    std::vector<Token> tokens;
-    // std::unordered_map<std::string, TokenType> keywords;
+    // Ring buffer of scanned but not yet consumed tokens
+    std::array<Token, MAX_LOOKAHEAD> lookahead;
+    size_t lookaheadHead = 0;
+    size_t lookaheadCount = 0;
+    Token scanned;
+    bool emitted = false;
+    bool lastWasReturn = false;
+    // Start of a string/char literal that ran to the end of the source
+    uint32_t unterminatedAt = UINT32_MAX;
     int current = 0;
-    int line = 1;
     int start = 0;
-    int column = 1;
+
+    Token lexToken();
 
     char advance();
+    void advanceTo(const char *p);
     bool isAtEnd() const;
-    char peek() const;
+    char peekChar() const;
     char peekNext() const;
     bool match(char expected);
     void addToken(TokenType type);
-    void addToken(TokenType type, const std::string &lexeme);
+    void addToken(TokenType type, std::string_view lexeme, TokenValue value = TokenValue(),
+                  uint8_t flags = 0);
+    void addError(const std::string &message);
     void string();
     void number();
     void charliteral();
+    void checkUtf8(std::string_view body, const char *what);
     void identifier();
     bool isAlpha(char c) const;
     bool isAlphaNumeric(char c) const;
     bool isDigit(char c) const;
     bool isWhitespace(char c) const;
-    void scanToken();
-    void handleIdentifierOrKeyword();
+    bool scanToken();
 };
 
 } // namespace umbra
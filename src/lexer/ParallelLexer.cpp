@@ -0,0 +1,159 @@
+#include "ParallelLexer.h"
+#include <llvm/Support/ThreadPool.h>
+#include <llvm/Support/Threading.h>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace umbra {
+
+struct ParallelLexer::Chunk {
+    Chunk(const SourceBuffer &buffer, uint32_t begin, uint32_t end)
+        : begin(begin), end(end), tokens(buffer) {}
+
+    uint32_t begin;
+    uint32_t end;
+    TokenBuffer tokens;
+    ErrorManager errors;
+    uint32_t stop = 0; // where the speculative lexer stopped (>= end)
+    uint32_t unterminatedAt = UINT32_MAX;
+    bool failed = false;
+};
+
+ParallelLexer::ParallelLexer(const SourceBuffer &buffer, ErrorManager &errorManager,
+                             unsigned threads, size_t minChunkSize)
+    : buffer(buffer), errorManager(errorManager), threads(threads),
+      minChunkSize(std::max<size_t>(minChunkSize, 1)) {
+    errorManager.setSourceBuffer(&buffer);
+}
+
+TokenBuffer ParallelLexer::tokenize() {
+    llvm::ThreadPoolStrategy strategy = llvm::hardware_concurrency(threads);
+    size_t chunkCount = std::min<size_t>(strategy.compute_thread_count() * 4,
+                                         buffer.size() / minChunkSize + 1);
+    std::vector<uint32_t> bounds = splitAtNewlines(chunkCount);
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    for (size_t i = 0; i + 1 < bounds.size(); ++i)
+        chunks.push_back(std::make_unique<Chunk>(buffer, bounds[i], bounds[i + 1]));
+
+    if (chunks.size() > 1) {
+        llvm::ThreadPool pool(strategy);
+        for (auto &chunk : chunks)
+            pool.async([this, &chunk] { lexChunk(buffer, *chunk); });
+        pool.wait();
+    } else {
+        for (auto &chunk : chunks)
+            lexChunk(buffer, *chunk);
+    }
+
+    // Stitch. `pos` is always a position the serial lexer reaches between tokens.
+    TokenBuffer tokens(buffer);
+    size_t total = 0;
+    for (const auto &chunk : chunks)
+        total += chunk->tokens.size();
+    tokens.reserve(total + 1);
+
+    uint32_t pos = 0;
+    for (const auto &chunk : chunks) {
+        if (pos >= chunk->end)
+            continue; // swallowed by a literal from an earlier chunk
+        if (isSyncPoint(*chunk, pos)) {
+            appendFrom(*chunk, pos, tokens);
+            pos = chunk->stop;
+            continue;
+        }
+
+        // Relex serially until the speculative lexer agrees with us again
+        Lexer lexer(buffer, errorManager);
+        lexer.seek(pos);
+        Token token;
+        for (;;) {
+            uint32_t at = lexer.position();
+            if (at > pos && at < chunk->end && isSyncPoint(*chunk, at)) {
+                appendFrom(*chunk, at, tokens);
+                pos = chunk->stop;
+                break;
+            }
+            if (!lexer.nextBefore(chunk->end, token)) {
+                pos = lexer.position();
+                break;
+            }
+            tokens.push_back(token);
+        }
+    }
+
+    tokens.push_back(
+        Token(TokenType::TOK_EOF, std::string_view(), static_cast<uint32_t>(buffer.size())));
+    return tokens;
+}
+
+// Chunk boundaries are placed just after a '\n', so every chunk but the first
+// starts at the beginning of a line.
+std::vector<uint32_t> ParallelLexer::splitAtNewlines(size_t chunkCount) const {
+    std::vector<uint32_t> bounds{0};
+    const size_t size = buffer.size();
+    for (size_t i = 1; i < chunkCount; ++i) {
+        size_t target = std::max<size_t>(size * i / chunkCount, bounds.back());
+        const char *newline = static_cast<const char *>(
+            std::memchr(buffer.begin() + target, '\n', size - target));
+        if (!newline)
+            break;
+        uint32_t bound = static_cast<uint32_t>(newline - buffer.begin()) + 1;
+        if (bound > bounds.back() && bound < size)
+            bounds.push_back(bound);
+    }
+    bounds.push_back(static_cast<uint32_t>(size));
+    return bounds;
+}
+
+void ParallelLexer::lexChunk(const SourceBuffer &buffer, Chunk &chunk) {
+    try {
+        Lexer lexer(buffer, chunk.errors);
+        lexer.seek(chunk.begin);
+        Token token;
+        while (lexer.nextBefore(chunk.end, token))
+            chunk.tokens.push_back(token);
+        chunk.stop = lexer.position();
+        chunk.unterminatedAt = lexer.unterminatedAt;
+    } catch (const std::exception &) {
+        // Too many errors for one chunk: let the stitcher relex it serially so
+        // the shared ErrorManager fails exactly where the serial lexer would.
+        chunk.failed = true;
+    }
+}
+
+// True if the speculative lexer of `chunk` was between tokens at `offset`, in
+// which case its output from there on equals the serial lexer's.
+bool ParallelLexer::isSyncPoint(const Chunk &chunk, uint32_t offset) const {
+    if (chunk.failed || offset < chunk.begin || offset > chunk.stop)
+        return false;
+    if (offset == chunk.begin)
+        return true;
+    if (offset > chunk.unterminatedAt)
+        return false;
+
+    // Last token starting before offset must end at or before it
+    size_t first = chunk.tokens.lowerBound(offset);
+    if (first == 0)
+        return true;
+    size_t last = first - 1;
+    TokenType kind = chunk.tokens.kind(last);
+    uint32_t quotes =
+        kind == TokenType::TOK_STRING_LITERAL || kind == TokenType::TOK_CHAR_LITERAL ? 2 : 0;
+    uint32_t end = chunk.tokens.offset(last) +
+                   static_cast<uint32_t>(chunk.tokens.lexeme(last).size()) + quotes;
+    return end <= offset;
+}
+
+// Appends the chunk's tokens and errors that start at or after offset
+void ParallelLexer::appendFrom(Chunk &chunk, uint32_t offset, TokenBuffer &tokens) {
+    for (size_t i = chunk.tokens.lowerBound(offset); i < chunk.tokens.size(); ++i)
+        tokens.push_back(chunk.tokens[i]);
+    for (auto &error : chunk.errors.takeErrors()) {
+        if (error->getLocation() >= buffer.getLocation(offset))
+            errorManager.addError(std::move(error));
+    }
+}
+
+} // namespace umbra
@@ -0,0 +1,46 @@
+#ifndef PARALLEL_LEXER_H
+#define PARALLEL_LEXER_H
+
+#include "../error/ErrorManager.h"
+#include "Lexer.h"
+#include "SourceBuffer.h"
+#include "TokenBuffer.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace umbra {
+
+// Lexes a large source on a thread pool. The buffer is split into chunks at
+// newline boundaries and each chunk is lexed speculatively, assuming it starts
+// outside any literal. The chunks are then stitched in order: if the previous
+// chunk's last token (e.g. a multi-line string) overhangs into the next one,
+// the speculative tokens are reused from the first position where both lexers
+// agree, and only the gap is relexed serially. Tokens, their order and the
+// reported errors are identical to Lexer::tokenize().
+class ParallelLexer {
+  public:
+    static constexpr size_t DEFAULT_MIN_CHUNK_SIZE = 1 << 20;
+
+    // threads == 0 uses the hardware concurrency
+    ParallelLexer(const SourceBuffer &buffer, ErrorManager &errorManager, unsigned threads = 0,
+                  size_t minChunkSize = DEFAULT_MIN_CHUNK_SIZE);
+
+    TokenBuffer tokenize();
+
+  private:
+    struct Chunk;
+
+    std::vector<uint32_t> splitAtNewlines(size_t chunkCount) const;
+    static void lexChunk(const SourceBuffer &buffer, Chunk &chunk);
+    bool isSyncPoint(const Chunk &chunk, uint32_t offset) const;
+    void appendFrom(Chunk &chunk, uint32_t offset, TokenBuffer &tokens);
+
+    const SourceBuffer &buffer;
+    ErrorManager &errorManager;
+    unsigned threads;
+    size_t minChunkSize;
+};
+
+} // namespace umbra
+
+#endif // PARALLEL_LEXER_H
@@ -0,0 +1,40 @@
+#include "SourceBuffer.h"
+#include "CharScan.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace umbra {
+
+std::unique_ptr<SourceBuffer> SourceBuffer::fromFile(const std::string &filename) {
+    // The lexer is bounds-checked, so no trailing '\0' is needed; asking for one
+    // would force a copy whenever the file size is a multiple of the page size.
+    auto buffer = llvm::MemoryBuffer::getFileOrSTDIN(filename, /*IsText=*/false,
+                                                     /*RequiresNullTerminator=*/false);
+    if (!buffer) {
+        throw std::runtime_error("Unable to open file: " + filename + " (" +
+                                 buffer.getError().message() + ")");
+    }
+    return std::make_unique<SourceBuffer>(std::move(*buffer));
+}
+
+LineColumn SourceBuffer::getLineColumn(uint32_t offset) const {
+    std::call_once(lineIndexBuilt, [this] { buildLineIndex(); });
+    // last line start <= offset
+    auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset);
+    size_t line = static_cast<size_t>(it - lineStarts.begin());
+    return {static_cast<int>(line), static_cast<int>(offset - lineStarts[line - 1]) + 1};
+}
+
+void SourceBuffer::buildLineIndex() const {
+    // Size the index exactly with a vectorized count, then fill it with memchr.
+    lineStarts.reserve(charscan::countNewlines(begin(), end()) + 1);
+    lineStarts.push_back(0);
+    for (const char *p = begin();
+         (p = static_cast<const char *>(std::memchr(p, '\n', end() - p))) != nullptr;) {
+        ++p;
+        lineStarts.push_back(static_cast<uint32_t>(p - begin()));
+    }
+}
+
+} // namespace umbra
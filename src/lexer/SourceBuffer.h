@@ -0,0 +1,79 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+#include "SourceLocation.h"
+#include <llvm/Support/MemoryBuffer.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace umbra {
+
+// 1-based position resolved from a byte offset
+struct LineColumn {
+    int line;
+    int column;
+};
+
+// Owns the bytes of a source file for the whole pipeline. Tokens and AST nodes
+// keep std::string_view slices into it, so it must outlive both.
+class SourceBuffer {
+  public:
+    explicit SourceBuffer(const std::string &text, const std::string &name = "<memory>")
+        : buffer(llvm::MemoryBuffer::getMemBufferCopy(text, name)) {}
+    explicit SourceBuffer(std::unique_ptr<llvm::MemoryBuffer> buffer)
+        : buffer(std::move(buffer)) {}
+
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+
+    // Maps the file read-only when the OS allows it and falls back to reading
+    // for pipes and "-" (stdin). Throws std::runtime_error if it cannot be opened.
+    static std::unique_ptr<SourceBuffer> fromFile(const std::string &filename);
+
+    std::string_view getText() const { return {begin(), size()}; }
+    std::string_view getName() const {
+        llvm::StringRef name = buffer->getBufferIdentifier();
+        return {name.data(), name.size()};
+    }
+    const char *begin() const { return buffer->getBufferStart(); }
+    const char *end() const { return buffer->getBufferEnd(); }
+    size_t size() const { return buffer->getBufferSize(); }
+
+    // Resolves a byte offset by binary search over the line-start index, which
+    // is built on first use. Tokens and diagnostics only carry offsets, so
+    // programs that never print a location never pay for it.
+    LineColumn getLineColumn(uint32_t offset) const;
+
+    // Mapping between byte offsets and SourceLocations. A buffer that is not
+    // registered with a SourceManager starts at raw location 1.
+    SourceLocation getStartLocation() const { return startLocation; }
+    SourceLocation getLocation(uint32_t offset) const {
+        return startLocation.getLocWithOffset(offset);
+    }
+    uint32_t getOffset(SourceLocation location) const {
+        return location.getRawEncoding() - startLocation.getRawEncoding();
+    }
+    // True for locations in [start, end], end included
+    bool contains(SourceLocation location) const {
+        return startLocation <= location && getOffset(location) <= size();
+    }
+
+  private:
+    friend class SourceManager;
+    void buildLineIndex() const;
+
+    SourceLocation startLocation = SourceLocation::getFromRawEncoding(1);
+
+    std::unique_ptr<llvm::MemoryBuffer> buffer;
+    mutable std::once_flag lineIndexBuilt;
+    mutable std::vector<uint32_t> lineStarts;
+};
+
+} // namespace umbra
+
+#endif // SOURCE_BUFFER_H
@@ -0,0 +1,40 @@
+#ifndef SOURCE_LOCATION_H
+#define SOURCE_LOCATION_H
+
+#include <cstdint>
+
+namespace umbra {
+
+// A position in the SourceManager's global offset space. Every registered
+// buffer owns a contiguous range of it, so a single 32-bit value identifies
+// both the file and the byte; line and column are decoded on demand. The raw
+// value 0 is reserved for the invalid location.
+class SourceLocation {
+  public:
+    constexpr SourceLocation() = default;
+
+    static constexpr SourceLocation getFromRawEncoding(uint32_t raw) {
+        SourceLocation location;
+        location.raw = raw;
+        return location;
+    }
+    constexpr uint32_t getRawEncoding() const { return raw; }
+    constexpr bool isValid() const { return raw != 0; }
+
+    constexpr SourceLocation getLocWithOffset(uint32_t offset) const {
+        return getFromRawEncoding(raw + offset);
+    }
+
+    constexpr bool operator==(SourceLocation other) const { return raw == other.raw; }
+    constexpr bool operator!=(SourceLocation other) const { return raw != other.raw; }
+    constexpr bool operator<(SourceLocation other) const { return raw < other.raw; }
+    constexpr bool operator<=(SourceLocation other) const { return raw <= other.raw; }
+    constexpr bool operator>=(SourceLocation other) const { return raw >= other.raw; }
+
+  private:
+    uint32_t raw = 0;
+};
+
+} // namespace umbra
+
+#endif // SOURCE_LOCATION_H
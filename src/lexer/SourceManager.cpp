@@ -0,0 +1,42 @@
+#include "SourceManager.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace umbra {
+
+const SourceBuffer &SourceManager::addBuffer(std::unique_ptr<SourceBuffer> buffer) {
+    uint64_t end = uint64_t(nextLocation) + buffer->size() + 1;
+    if (end > UINT32_MAX)
+        throw std::length_error("Source location space exhausted by " +
+                                std::string(buffer->getName()));
+    buffer->startLocation = SourceLocation::getFromRawEncoding(nextLocation);
+    nextLocation = static_cast<uint32_t>(end);
+    buffers.push_back(std::move(buffer));
+    return *buffers.back();
+}
+
+const SourceBuffer &SourceManager::loadFile(const std::string &filename) {
+    return addBuffer(SourceBuffer::fromFile(filename));
+}
+
+const SourceBuffer *SourceManager::getBuffer(SourceLocation location) const {
+    // Last buffer starting at or before location
+    auto it = std::upper_bound(buffers.begin(), buffers.end(), location,
+                               [](SourceLocation loc, const std::unique_ptr<SourceBuffer> &buffer) {
+                                   return loc < buffer->getStartLocation();
+                               });
+    if (!location.isValid() || it == buffers.begin())
+        return nullptr;
+    const SourceBuffer *buffer = std::prev(it)->get();
+    return buffer->contains(location) ? buffer : nullptr;
+}
+
+PresumedLoc SourceManager::getPresumedLoc(SourceLocation location) const {
+    const SourceBuffer *buffer = getBuffer(location);
+    if (!buffer)
+        return {std::string_view(), 0, 0};
+    LineColumn position = buffer->getLineColumn(buffer->getOffset(location));
+    return {buffer->getName(), position.line, position.column};
+}
+
+} // namespace umbra
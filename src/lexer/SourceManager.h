@@ -0,0 +1,48 @@
+#ifndef SOURCE_MANAGER_H
+#define SOURCE_MANAGER_H
+
+#include "SourceBuffer.h"
+#include "SourceLocation.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace umbra {
+
+// A SourceLocation decoded for display
+struct PresumedLoc {
+    std::string_view filename; // empty when the file is unknown
+    int line;
+    int column;
+};
+
+// Owns every buffer of a compilation and lays them out one after another in a
+// single 32-bit location space, in the style of Clang's SourceManager. Each
+// buffer's range also covers its end position, so EOF locations stay distinct.
+class SourceManager {
+  public:
+    SourceManager() = default;
+    SourceManager(const SourceManager &) = delete;
+    SourceManager &operator=(const SourceManager &) = delete;
+
+    // Takes ownership and assigns the buffer the next free range of locations.
+    // Throws std::length_error once the 32-bit space is exhausted.
+    const SourceBuffer &addBuffer(std::unique_ptr<SourceBuffer> buffer);
+    // SourceBuffer::fromFile + addBuffer
+    const SourceBuffer &loadFile(const std::string &filename);
+
+    // Buffer whose range contains location, or nullptr
+    const SourceBuffer *getBuffer(SourceLocation location) const;
+    PresumedLoc getPresumedLoc(SourceLocation location) const;
+    size_t getNumBuffers() const { return buffers.size(); }
+
+  private:
+    std::vector<std::unique_ptr<SourceBuffer>> buffers; // by increasing start location
+    uint32_t nextLocation = 1;                          // 0 is the invalid location
+};
+
+} // namespace umbra
+
+#endif // SOURCE_MANAGER_H
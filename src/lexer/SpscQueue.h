@@ -0,0 +1,48 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace umbra {
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Both operations are wait-free and never allocate; callers decide how
+// to wait when the queue is full or empty.
+template <typename T, size_t Capacity> class SpscQueue {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+  public:
+    // Producer side; leaves `value` untouched and returns false when full
+    bool tryPush(T &&value) {
+        size_t write = writeIndex.load(std::memory_order_relaxed);
+        if (write - readIndex.load(std::memory_order_acquire) == Capacity)
+            return false;
+        slots[write & (Capacity - 1)] = std::move(value);
+        writeIndex.store(write + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side; returns false when empty
+    bool tryPop(T &value) {
+        size_t read = readIndex.load(std::memory_order_relaxed);
+        if (writeIndex.load(std::memory_order_acquire) == read)
+            return false;
+        value = std::move(slots[read & (Capacity - 1)]);
+        readIndex.store(read + 1, std::memory_order_release);
+        return true;
+    }
+
+  private:
+    // On separate cache lines so the two threads do not invalidate each other
+    alignas(64) std::atomic<size_t> readIndex{0};
+    alignas(64) std::atomic<size_t> writeIndex{0};
+    std::array<T, Capacity> slots;
+};
+
+} // namespace umbra
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,52 @@
+#include "SymbolTable.h"
+#include <llvm/Support/raw_ostream.h>
+#include <cassert>
+#include <mutex>
+#include <ostream>
+
+namespace umbra {
+
+std::string_view Symbol::str() const { return SymbolTable::global().spelling(*this); }
+
+std::ostream &operator<<(std::ostream &os, Symbol symbol) { return os << symbol.str(); }
+
+llvm::raw_ostream &operator<<(llvm::raw_ostream &os, Symbol symbol) {
+    std::string_view spelling = symbol.str();
+    return os << llvm::StringRef(spelling.data(), spelling.size());
+}
+
+SymbolTable &SymbolTable::global() {
+    static SymbolTable table;
+    return table;
+}
+
+Symbol SymbolTable::intern(std::string_view spelling) {
+    llvm::StringRef key(spelling.data(), spelling.size());
+    {
+        // Most lookups hit an existing entry, so only readers contend
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = ids.find(key);
+        if (it != ids.end())
+            return Symbol(it->second);
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    auto inserted = ids.try_emplace(key, static_cast<uint32_t>(spellings.size()));
+    if (inserted.second) {
+        llvm::StringRef stored = inserted.first->first();
+        spellings.emplace_back(stored.data(), stored.size());
+    }
+    return Symbol(inserted.first->second);
+}
+
+std::string_view SymbolTable::spelling(Symbol symbol) const {
+    assert(symbol.isValid() && "spelling of an invalid symbol");
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return spellings[symbol.getId()];
+}
+
+size_t SymbolTable::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return spellings.size();
+}
+
+} // namespace umbra
@@ -0,0 +1,69 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Support/Allocator.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <shared_mutex>
+#include <string_view>
+#include <vector>
+
+namespace llvm {
+class raw_ostream;
+}
+
+namespace umbra {
+
+// Dense 32-bit handle for an interned identifier. Two symbols are equal iff
+// their spellings are, so name comparison and hashing are integer operations.
+class Symbol {
+  public:
+    static constexpr uint32_t INVALID_ID = UINT32_MAX;
+
+    constexpr Symbol() = default;
+    constexpr explicit Symbol(uint32_t id) : id(id) {}
+
+    uint32_t getId() const { return id; }
+    bool isValid() const { return id != INVALID_ID; }
+    // Spelling, resolved through SymbolTable::global()
+    std::string_view str() const;
+
+    bool operator==(Symbol other) const { return id == other.id; }
+    bool operator!=(Symbol other) const { return id != other.id; }
+    bool operator<(Symbol other) const { return id < other.id; }
+
+  private:
+    uint32_t id = INVALID_ID;
+};
+
+std::ostream &operator<<(std::ostream &os, Symbol symbol);
+llvm::raw_ostream &operator<<(llvm::raw_ostream &os, Symbol symbol);
+
+// Maps identifier spellings to dense IDs, in order of first appearance. The
+// lexer interns every identifier once, so later phases never hash names again.
+// Spellings are copied into the table, so symbols outlive the SourceBuffer.
+// Safe to use from several lexer threads at once.
+class SymbolTable {
+  public:
+    static SymbolTable &global();
+
+    Symbol intern(std::string_view spelling);
+    std::string_view spelling(Symbol symbol) const;
+    size_t size() const;
+
+  private:
+    mutable std::shared_mutex mutex;
+    llvm::StringMap<uint32_t, llvm::BumpPtrAllocator> ids;
+    std::vector<std::string_view> spellings; // keys owned by `ids`, indexed by ID
+};
+
+} // namespace umbra
+
+template <> struct std::hash<umbra::Symbol> {
+    size_t operator()(umbra::Symbol symbol) const { return symbol.getId(); }
+};
+
+#endif // SYMBOL_TABLE_H
@@ -0,0 +1,69 @@
+#include "TokenBuffer.h"
+#include <algorithm>
+#include <cassert>
+
+namespace umbra {
+
+namespace {
+
+// Overwrites the common prefix in place so only the size difference is moved
+template <typename T>
+void replaceRange(std::vector<T> &values, size_t first, size_t last,
+                  const std::vector<T> &replacement) {
+    size_t common = std::min(last - first, replacement.size());
+    std::copy_n(replacement.begin(), common, values.begin() + first);
+    if (replacement.size() > common)
+        values.insert(values.begin() + first + common, replacement.begin() + common,
+                      replacement.end());
+    else
+        values.erase(values.begin() + first + common, values.begin() + last);
+}
+
+} // namespace
+
+void TokenBuffer::push_back(const Token &token) {
+    assert((token.type == TokenType::TOK_EOF ||
+            token.lexeme.data() ==
+                buffer->begin() + token.offset + lexemeSkip(token.type)) &&
+           "token lexeme must be a view of the buffer at its offset");
+    kinds.push_back(token.type);
+    offsets.push_back(token.offset);
+    lengths.push_back(static_cast<uint32_t>(token.lexeme.size()));
+    tokenFlags.push_back(token.flags);
+    values.push_back(token.value);
+}
+
+void TokenBuffer::reserve(size_t count) {
+    kinds.reserve(count);
+    offsets.reserve(count);
+    lengths.reserve(count);
+    tokenFlags.reserve(count);
+    values.reserve(count);
+}
+
+void TokenBuffer::clear() {
+    kinds.clear();
+    offsets.clear();
+    lengths.clear();
+    tokenFlags.clear();
+    values.clear();
+}
+
+size_t TokenBuffer::lowerBound(uint32_t offset) const {
+    return std::lower_bound(offsets.begin(), offsets.end(), offset) - offsets.begin();
+}
+
+void TokenBuffer::splice(size_t first, size_t last, const TokenBuffer &replacement,
+                         int64_t shift) {
+    assert(first <= last && last <= size() && "invalid splice range");
+    for (size_t i = last; i < offsets.size(); ++i)
+        offsets[i] = static_cast<uint32_t>(offsets[i] + shift);
+    replaceRange(kinds, first, last, replacement.kinds);
+    replaceRange(offsets, first, last, replacement.offsets);
+    replaceRange(lengths, first, last, replacement.lengths);
+    replaceRange(tokenFlags, first, last, replacement.tokenFlags);
+    replaceRange(values, first, last, replacement.values);
+    buffer = replacement.buffer;
+}
+
+} // namespace umbra
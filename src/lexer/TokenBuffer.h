@@ -0,0 +1,105 @@
+#ifndef TOKEN_BUFFER_H
+#define TOKEN_BUFFER_H
+
+#include "SourceBuffer.h"
+#include "Tokens.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+namespace umbra {
+
+// Structure-of-arrays token storage. Kinds live in a dense byte array so scans
+// over token types touch one cache line per 64 tokens; offsets, lexeme
+// lengths, flags and decoded values are kept in parallel arrays and lexemes are
+// rebuilt as views into the SourceBuffer on access.
+class TokenBuffer {
+  public:
+    // Multi-pass, but tokens are rebuilt on access, so `reference` is a value
+    class const_iterator {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Token;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Token;
+
+        const_iterator() = default;
+        const_iterator(const TokenBuffer *tokens, size_t index) : tokens(tokens), index(index) {}
+        Token operator*() const { return (*tokens)[index]; }
+        const_iterator &operator++() {
+            ++index;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            const_iterator previous = *this;
+            ++index;
+            return previous;
+        }
+        bool operator==(const const_iterator &other) const { return index == other.index; }
+        bool operator!=(const const_iterator &other) const { return index != other.index; }
+
+      private:
+        const TokenBuffer *tokens = nullptr;
+        size_t index = 0;
+    };
+
+    explicit TokenBuffer(const SourceBuffer &buffer) : buffer(&buffer) {}
+
+    void push_back(const Token &token);
+    void reserve(size_t count);
+    void clear();
+
+    size_t size() const { return kinds.size(); }
+    bool empty() const { return kinds.empty(); }
+
+    TokenType kind(size_t i) const { return kinds[i]; }
+    uint32_t offset(size_t i) const { return offsets[i]; }
+    SourceLocation location(size_t i) const { return buffer->getLocation(offsets[i]); }
+    // Lexeme length, readable even after the SourceBuffer has been replaced
+    uint32_t length(size_t i) const { return lengths[i]; }
+    uint8_t flags(size_t i) const { return tokenFlags[i]; }
+    TokenValue value(size_t i) const { return values[i]; }
+    Symbol symbol(size_t i) const {
+        return kinds[i] == TokenType::TOK_IDENTIFIER ? values[i].symbol : Symbol();
+    }
+    std::string_view lexeme(size_t i) const {
+        return buffer->getText().substr(offsets[i] + lexemeSkip(kinds[i]), lengths[i]);
+    }
+    Token operator[](size_t i) const {
+        return Token(kinds[i], lexeme(i), offsets[i], values[i], tokenFlags[i]);
+    }
+
+    // Index of the first token starting at or after offset
+    size_t lowerBound(uint32_t offset) const;
+
+    // Replaces tokens [first, last) with `replacement`, adds `shift` to the
+    // offsets of the tokens after them and rebinds to the replacement's buffer.
+    // Used by incremental relexing after an edit.
+    void splice(size_t first, size_t last, const TokenBuffer &replacement, int64_t shift);
+
+    const std::vector<TokenType> &getKinds() const { return kinds; }
+    const SourceBuffer &getSourceBuffer() const { return *buffer; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+  private:
+    // String and char literal lexemes exclude the opening quote
+    static uint32_t lexemeSkip(TokenType kind) {
+        return kind == TokenType::TOK_STRING_LITERAL || kind == TokenType::TOK_CHAR_LITERAL;
+    }
+
+    const SourceBuffer *buffer;
+    std::vector<TokenType> kinds;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint8_t> tokenFlags;
+    std::vector<TokenValue> values;
+};
+
+} // namespace umbra
+
+#endif // TOKEN_BUFFER_H
@@ -0,0 +1,206 @@
+#include "TokenCache.h"
+#include "../support/BinaryReader.h"
+#include "../support/ContentHash.h"
+#include "../support/StableCodes.h"
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Support/EndianStream.h>
+#include <llvm/Support/FileUtilities.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/LEB128.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/raw_ostream.h>
+#include <cstring>
+#include <vector>
+
+namespace umbra {
+
+namespace {
+
+constexpr char MAGIC[] = "UMBTOK";
+constexpr size_t MAGIC_SIZE = sizeof(MAGIC) - 1;
+constexpr uint8_t VERSION = 2;
+
+// Kinds are written as their code in this table rather than as TokenType
+// values, so inserting or reordering tokens leaves existing entries readable.
+// Append only. A token missing from the table is written as an invalid code
+// and its entry never loads; the assert catches most such omissions.
+using T = TokenType;
+constexpr TokenType KIND_TABLE[] = {
+    T::TOK_EOF, T::TOK_NEWLINE, T::TOK_INT, T::TOK_FLOAT, T::TOK_BOOL, T::TOK_CHAR, T::TOK_STRING,
+    T::TOK_IF, T::TOK_ELSE, T::TOK_REPEAT, T::TOK_TIMES, T::TOK_FUNC, T::TOK_RETURN, T::TOK_NEW,
+    T::TOK_DELETE, T::TOK_AND, T::TOK_OR, T::TOK_EQUAL, T::TOK_DIFFERENT, T::TOK_LESS,
+    T::TOK_GREATER, T::TOK_LESS_EQ, T::TOK_GREATER_EQ, T::TOK_ASSIGN, T::TOK_MINUS, T::TOK_ADD,
+    T::TOK_MULT, T::TOK_DIV, T::TOK_ARROW, T::TOK_IDENTIFIER, T::TOK_NUMBER, T::TOK_STRING_LITERAL,
+    T::TOK_CHAR_LITERAL, T::TOK_LEFT_BRACE, T::TOK_RIGHT_BRACE, T::TOK_LEFT_BRACKET,
+    T::TOK_RIGHT_BRACKET, T::TOK_LEFT_PAREN, T::TOK_RIGHT_PAREN, T::TOK_COMMA, T::TOK_DOT};
+constexpr StableCodes<TokenType, sizeof(KIND_TABLE) / sizeof(KIND_TABLE[0])> KINDS(KIND_TABLE);
+static_assert(KINDS.covers(static_cast<size_t>(TokenType::TOK_DOT) + 1),
+              "every TokenType needs exactly one .umbtok code");
+
+uint32_t lexemeSkip(TokenType kind) {
+    return kind == TokenType::TOK_STRING_LITERAL || kind == TokenType::TOK_CHAR_LITERAL;
+}
+
+} // namespace
+
+std::string TokenCache::pathFor(const SourceBuffer &buffer) const {
+    llvm::SmallString<128> path(directory);
+    llvm::sys::path::append(path, llvm::utohexstr(contentHash(buffer.getText()),
+                                                  /*LowerCase=*/true) +
+                                      ".umbtok");
+    return std::string(path.str());
+}
+
+std::optional<TokenBuffer> TokenCache::load(const SourceBuffer &buffer) const {
+    // The entry is mapped, not read, and decoded in a single pass
+    auto entry = llvm::MemoryBuffer::getFile(pathFor(buffer), /*IsText=*/false,
+                                             /*RequiresNullTerminator=*/false);
+    if (!entry)
+        return std::nullopt;
+    return deserialize((*entry)->getBuffer(), buffer);
+}
+
+bool TokenCache::store(const TokenBuffer &tokens) const {
+    if (llvm::sys::fs::create_directories(directory))
+        return false;
+    std::string path = pathFor(tokens.getSourceBuffer());
+    // Readers never observe a partially written entry
+    if (llvm::Error error = llvm::writeFileAtomically(path + ".tmp%%%%%%", path,
+                                                      serialize(tokens))) {
+        llvm::consumeError(std::move(error));
+        return false;
+    }
+    return true;
+}
+
+std::string TokenCache::serialize(const TokenBuffer &tokens) {
+    const SourceBuffer &buffer = tokens.getSourceBuffer();
+
+    // Identifier spellings, in order of first use
+    llvm::DenseMap<uint32_t, uint32_t> stringIndex;
+    std::vector<Symbol> strings;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens.kind(i) != TokenType::TOK_IDENTIFIER)
+            continue;
+        Symbol symbol = tokens.symbol(i);
+        if (stringIndex.try_emplace(symbol.getId(), static_cast<uint32_t>(strings.size())).second)
+            strings.push_back(symbol);
+    }
+
+    std::string data;
+    llvm::raw_string_ostream out(data);
+    out << llvm::StringRef(MAGIC, MAGIC_SIZE);
+    out << static_cast<char>(VERSION) << '\0';
+    llvm::support::endian::write<uint64_t>(out, contentHash(buffer.getText()),
+                                           llvm::support::little);
+    llvm::encodeULEB128(buffer.size(), out);
+    llvm::encodeULEB128(tokens.size(), out);
+    llvm::encodeULEB128(strings.size(), out);
+    for (Symbol symbol : strings) {
+        std::string_view spelling = symbol.str();
+        llvm::encodeULEB128(spelling.size(), out);
+        out << llvm::StringRef(spelling.data(), spelling.size());
+    }
+
+    uint32_t previous = 0;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        TokenType kind = tokens.kind(i);
+        out << static_cast<char>(KINDS.encode(kind));
+        llvm::encodeULEB128(tokens.offset(i) - previous, out);
+        previous = tokens.offset(i);
+
+        if (kind == TokenType::TOK_IDENTIFIER) {
+            llvm::encodeULEB128(stringIndex[tokens.symbol(i).getId()], out);
+            continue;
+        }
+        llvm::encodeULEB128(tokens.length(i), out);
+        if (kind == TokenType::TOK_NUMBER) {
+            out << static_cast<char>(tokens.flags(i));
+            TokenValue value = tokens.value(i);
+            if (tokens.flags(i) & TOKEN_FLAG_FLOAT) {
+                uint64_t bits;
+                std::memcpy(&bits, &value.real, sizeof(bits));
+                llvm::support::endian::write<uint64_t>(out, bits, llvm::support::little);
+            } else {
+                llvm::encodeULEB128(zigzagEncode(value.integer), out);
+            }
+        }
+    }
+    out.flush();
+    return data;
+}
+
+std::optional<TokenBuffer> TokenCache::deserialize(llvm::StringRef data,
+                                                   const SourceBuffer &buffer) {
+    BinaryReader in(data);
+    if (in.bytes(MAGIC_SIZE) != llvm::StringRef(MAGIC, MAGIC_SIZE) || in.byte() != VERSION)
+        return std::nullopt;
+    in.byte(); // reserved
+    if (in.u64() != contentHash(buffer.getText()) || in.uleb() != buffer.size() || in.failed)
+        return std::nullopt;
+
+    uint64_t tokenCount = in.uleb();
+    uint64_t stringCount = in.uleb();
+    // Each entry takes at least one byte, which bounds what we reserve
+    if (in.failed || tokenCount > data.size() || stringCount > data.size())
+        return std::nullopt;
+
+    // Symbol IDs are per process, so spellings are interned again
+    std::vector<Symbol> symbols;
+    symbols.reserve(stringCount);
+    for (uint64_t i = 0; i < stringCount; ++i) {
+        llvm::StringRef spelling = in.bytes(in.uleb());
+        if (in.failed)
+            return std::nullopt;
+        symbols.push_back(SymbolTable::global().intern({spelling.data(), spelling.size()}));
+    }
+
+    std::string_view text = buffer.getText();
+    TokenBuffer tokens(buffer);
+    tokens.reserve(tokenCount);
+    uint64_t offset = 0;
+    for (uint64_t i = 0; i < tokenCount; ++i) {
+        TokenType kind;
+        if (!KINDS.decode(in.byte(), kind))
+            return std::nullopt;
+        offset += in.uleb();
+
+        TokenValue value;
+        uint8_t flags = 0;
+        uint64_t length;
+        if (kind == TokenType::TOK_IDENTIFIER) {
+            uint64_t index = in.uleb();
+            if (index >= symbols.size())
+                return std::nullopt;
+            value = TokenValue(symbols[index]);
+            length = symbols[index].str().size();
+        } else {
+            length = in.uleb();
+            if (kind == TokenType::TOK_NUMBER) {
+                flags = in.byte();
+                if (flags & TOKEN_FLAG_FLOAT) {
+                    uint64_t bits = in.u64();
+                    std::memcpy(&value.real, &bits, sizeof(bits));
+                } else {
+                    value = TokenValue(zigzagDecode(in.uleb()));
+                }
+            }
+        }
+
+        uint64_t skip = lexemeSkip(kind);
+        if (in.failed || offset + skip + length > text.size())
+            return std::nullopt;
+        std::string_view lexeme = text.substr(offset + skip, length);
+        if (kind == TokenType::TOK_IDENTIFIER && lexeme != value.symbol.str())
+            return std::nullopt;
+        tokens.push_back(Token(kind, lexeme, static_cast<uint32_t>(offset), value, flags));
+    }
+
+    if (!in.atEnd() || tokens.empty() || tokens.kind(tokens.size() - 1) != TokenType::TOK_EOF)
+        return std::nullopt;
+    return tokens;
+}
+
+} // namespace umbra
@@ -0,0 +1,49 @@
+#ifndef TOKEN_CACHE_H
+#define TOKEN_CACHE_H
+
+#include "SourceBuffer.h"
+#include "TokenBuffer.h"
+#include <llvm/ADT/StringRef.h>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace umbra {
+
+// On-disk cache of Lexer::tokenize() output, keyed by an xxHash64 of the
+// source bytes: an unchanged file maps its .umbtok entry instead of being
+// relexed. Only clean lexes should be stored, since lexical errors are not
+// recorded.
+//
+// Format (.umbtok, little endian):
+//   "UMBTOK" version:u8 reserved:u8 hash:u64
+//   sourceSize:uleb tokenCount:uleb stringCount:uleb
+//   strings:  { length:uleb bytes }*            identifier spellings
+//   tokens:   { kind:u8 offsetDelta:uleb payload }*
+// where the payload is a string index for identifiers and the lexeme length
+// otherwise; numbers append flags:u8 and a zigzag integer or a raw double.
+// A kind is its code in a fixed table of token types, not its TokenType value,
+// and that table is part of the format: the version changes with it.
+class TokenCache {
+  public:
+    explicit TokenCache(std::string directory) : directory(std::move(directory)) {}
+
+    // Cached tokens for `buffer`, or nothing on a miss or an unreadable entry
+    std::optional<TokenBuffer> load(const SourceBuffer &buffer) const;
+    // Returns false if the entry could not be written
+    bool store(const TokenBuffer &tokens) const;
+
+    std::string pathFor(const SourceBuffer &buffer) const;
+
+    static std::string serialize(const TokenBuffer &tokens);
+    // Validates the header and every token against `buffer`
+    static std::optional<TokenBuffer> deserialize(llvm::StringRef data,
+                                                  const SourceBuffer &buffer);
+
+  private:
+    std::string directory;
+};
+
+} // namespace umbra
+
+#endif // TOKEN_CACHE_H
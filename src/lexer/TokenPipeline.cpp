@@ -0,0 +1,97 @@
+#include "TokenPipeline.h"
+#include "../support/Trace.h"
+
+namespace umbra {
+
+namespace {
+
+// Spins briefly before yielding: the other side is usually only a few tokens
+// behind, but on an oversubscribed machine it needs our core to make progress.
+template <typename Condition> void waitUntil(Condition condition) {
+    for (int spins = 0; !condition(); ++spins) {
+        if (spins >= 64)
+            std::this_thread::yield();
+    }
+}
+
+} // namespace
+
+TokenPipeline::TokenPipeline(Lexer &lexer, size_t chunkSize)
+    : lexer(lexer), chunkSize(chunkSize ? chunkSize : 1) {
+    producer = std::thread([this] { produce(); });
+}
+
+TokenPipeline::~TokenPipeline() {
+    // Unblocks a producer waiting on a full queue if parsing stopped early
+    cancelled.store(true, std::memory_order_relaxed);
+    producer.join();
+}
+
+void TokenPipeline::produce() {
+    auto publish = [this](Chunk &&chunk) {
+        waitUntil([&] {
+            return filled.tryPush(std::move(chunk)) ||
+                   cancelled.load(std::memory_order_relaxed);
+        });
+    };
+
+    Chunk chunk;
+    bool done = false;
+    while (!done && !cancelled.load(std::memory_order_relaxed)) {
+        recycled.tryPop(chunk);
+        chunk.clear();
+        chunk.reserve(chunkSize);
+        try {
+            while (chunk.size() < chunkSize && !done) {
+                chunk.push_back(lexer.next());
+                done = chunk.back().type == TokenType::TOK_EOF;
+            }
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        UMBRA_TRACE(Lexer, "pipeline chunk of " << chunk.size() << " tokens");
+        if (!chunk.empty())
+            publish(std::move(chunk));
+        // An empty chunk tells the consumer the lexer failed; the queue's
+        // release/acquire pair publishes `failure` along with it
+        if (failure) {
+            publish(Chunk());
+            done = true;
+        }
+    }
+}
+
+void TokenPipeline::fetch() {
+    // The queue is full only if the lexer is far ahead; dropping a chunk then
+    // just means the lexer allocates a new one
+    if (current.capacity())
+        recycled.tryPush(std::move(current));
+    waitUntil([&] { return filled.tryPop(current); });
+    position = 0;
+    if (current.empty()) {
+        failed = true;
+        std::rethrow_exception(failure);
+    }
+}
+
+const Token &TokenPipeline::peek() {
+    if (failed)
+        std::rethrow_exception(failure);
+    if (position == current.size()) {
+        // Nothing is produced after EOF
+        if (!current.empty() && current.back().type == TokenType::TOK_EOF)
+            position = current.size() - 1;
+        else
+            fetch();
+    }
+    return current[position];
+}
+
+Token TokenPipeline::next() {
+    Token token = peek();
+    if (token.type != TokenType::TOK_EOF)
+        position++;
+    return token;
+}
+
+} // namespace umbra
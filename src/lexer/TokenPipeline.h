@@ -0,0 +1,65 @@
+#ifndef TOKEN_PIPELINE_H
+#define TOKEN_PIPELINE_H
+
+#include "Lexer.h"
+#include "SpscQueue.h"
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace umbra {
+
+// Runs a Lexer on its own thread and hands its tokens to a single consumer
+// (the Parser) in fixed-size chunks through a lock-free queue, so lexing and
+// parsing overlap. Consumed chunks go back to the lexer thread to be refilled,
+// which keeps the steady state allocation-free.
+//
+// The lexer reports errors from its thread, so its ErrorManager is shared
+// with the consumer; ErrorManager serializes concurrent reports.
+class TokenPipeline {
+  public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 4096;
+
+    // Starts lexing immediately; `lexer` must not be used until the pipeline
+    // is destroyed
+    explicit TokenPipeline(Lexer &lexer, size_t chunkSize = DEFAULT_CHUNK_SIZE);
+    ~TokenPipeline();
+
+    TokenPipeline(const TokenPipeline &) = delete;
+    TokenPipeline &operator=(const TokenPipeline &) = delete;
+
+    // Same contract as Lexer::peek()/next(): both block until the lexer thread
+    // has produced the token, and the stream ends in a sticky TOK_EOF. An
+    // exception thrown by the lexer is rethrown here once its tokens run out.
+    const Token &peek();
+    Token next();
+
+    const SourceBuffer &getSourceBuffer() const { return lexer.getSourceBuffer(); }
+
+  private:
+    using Chunk = std::vector<Token>;
+    static constexpr size_t QUEUE_CAPACITY = 64;
+
+    void produce();
+    void fetch();
+
+    Lexer &lexer;
+    size_t chunkSize;
+    SpscQueue<Chunk, QUEUE_CAPACITY> filled;
+    SpscQueue<Chunk, QUEUE_CAPACITY> recycled;
+    std::atomic<bool> cancelled{false};
+    std::exception_ptr failure;
+
+    // Consumer state
+    Chunk current;
+    size_t position = 0;
+    bool failed = false;
+
+    std::thread producer;
+};
+
+} // namespace umbra
+
+#endif // TOKEN_PIPELINE_H
@@ -2,12 +2,16 @@
 #ifndef TOKENS_H
 #define TOKENS_H
 
+#include "SymbolTable.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 
 namespace umbra {
 
-enum class TokenType {
+// Fits in a byte so token kinds can be stored densely (see TokenBuffer)
+enum class TokenType : uint8_t {
     // End of file token
     TOK_EOF,
     TOK_NEWLINE,
@@ -76,33 +80,114 @@ enum class TokenType {
 
 };
 
+// Payload decoded by the lexer while scanning, so later phases never re-parse
+// a lexeme. Which member is live depends on the token type (and flags).
+union TokenValue {
+    Symbol symbol{}; // TOK_IDENTIFIER
+    int64_t integer; // TOK_NUMBER
+    double real;     // TOK_NUMBER with TOKEN_FLAG_FLOAT
+
+    constexpr TokenValue() = default;
+    constexpr explicit TokenValue(Symbol s) : symbol(s) {}
+    constexpr explicit TokenValue(int64_t i) : integer(i) {}
+    constexpr explicit TokenValue(double d) : real(d) {}
+};
+
+// Bits of Token::flags
+enum TokenFlag : uint8_t {
+    TOKEN_FLAG_FLOAT = 1 << 0, // number literal with a fractional part
+};
+
+struct Token {
+    TokenType type = TokenType::TOK_EOF;
+    uint8_t flags = 0;
+    uint32_t offset = 0;     // byte offset in its buffer; see SourceBuffer::getLocation
+    std::string_view lexeme; // slice of the SourceBuffer, never owned
+    TokenValue value;
+
+    Token() = default;
+    Token(TokenType t, std::string_view l, uint32_t off, TokenValue v = TokenValue(),
+          uint8_t f = 0)
+        : type(t), flags(f), offset(off), lexeme(l), value(v) {}
+
+    bool isFloat() const { return flags & TOKEN_FLAG_FLOAT; }
+};
+
 class TokenManager {
   public:
-    // Devuelve el mapa de palabras clave
-    const std::unordered_map<std::string, TokenType> &getKeywords() const {
-        static const std::unordered_map<std::string, TokenType> keywords = {
-            {"int", TokenType::TOK_INT},
-            {"float", TokenType::TOK_FLOAT},
-            {"bool", TokenType::TOK_BOOL},
-            {"char", TokenType::TOK_CHAR},
-            {"string", TokenType::TOK_STRING},
-            {"if", TokenType::TOK_IF},
-            {"else", TokenType::TOK_ELSE},
-            {"repeat", TokenType::TOK_REPEAT},
-            {"times", TokenType::TOK_TIMES},
-            {"func", TokenType::TOK_FUNC},
-            {"return", TokenType::TOK_RETURN},
-            {"new", TokenType::TOK_NEW},
-            {"delete", TokenType::TOK_DELETE},
-            {"and", TokenType::TOK_AND},
-            {"or", TokenType::TOK_OR},
-            {"equal", TokenType::TOK_EQUAL},
-            {"different", TokenType::TOK_DIFFERENT},
-            {"less_than", TokenType::TOK_LESS},
-            {"greater_than", TokenType::TOK_GREATER},
-            {"less_or_equal", TokenType::TOK_LESS_EQ},
-            {"greater_or_equal", TokenType::TOK_GREATER_EQ}};
-        return keywords;
+    // Clasifica un identificador como palabra clave sin reservar memoria. La
+    // longitud y un carácter distintivo dejan un único candidato, que se
+    // confirma con una sola comparación.
+    static constexpr TokenType classifyIdentifier(std::string_view text) {
+        switch (text.size()) {
+        case 2:
+            switch (text[0]) {
+            case 'i':
+                return matchKeyword(text, "if", TokenType::TOK_IF);
+            case 'o':
+                return matchKeyword(text, "or", TokenType::TOK_OR);
+            }
+            break;
+        case 3:
+            switch (text[0]) {
+            case 'i':
+                return matchKeyword(text, "int", TokenType::TOK_INT);
+            case 'n':
+                return matchKeyword(text, "new", TokenType::TOK_NEW);
+            case 'a':
+                return matchKeyword(text, "and", TokenType::TOK_AND);
+            }
+            break;
+        case 4:
+            switch (text[0]) {
+            case 'b':
+                return matchKeyword(text, "bool", TokenType::TOK_BOOL);
+            case 'c':
+                return matchKeyword(text, "char", TokenType::TOK_CHAR);
+            case 'e':
+                return matchKeyword(text, "else", TokenType::TOK_ELSE);
+            case 'f':
+                return matchKeyword(text, "func", TokenType::TOK_FUNC);
+            }
+            break;
+        case 5:
+            switch (text[0]) {
+            case 'f':
+                return matchKeyword(text, "float", TokenType::TOK_FLOAT);
+            case 't':
+                return matchKeyword(text, "times", TokenType::TOK_TIMES);
+            case 'e':
+                return matchKeyword(text, "equal", TokenType::TOK_EQUAL);
+            }
+            break;
+        case 6:
+            switch (text[0]) {
+            case 's':
+                return matchKeyword(text, "string", TokenType::TOK_STRING);
+            case 'd':
+                return matchKeyword(text, "delete", TokenType::TOK_DELETE);
+            case 'r':
+                // "repeat" / "return" se separan en el tercer carácter
+                return text[2] == 'p' ? matchKeyword(text, "repeat", TokenType::TOK_REPEAT)
+                                      : matchKeyword(text, "return", TokenType::TOK_RETURN);
+            }
+            break;
+        case 9:
+            switch (text[0]) {
+            case 'd':
+                return matchKeyword(text, "different", TokenType::TOK_DIFFERENT);
+            case 'l':
+                return matchKeyword(text, "less_than", TokenType::TOK_LESS);
+            }
+            break;
+        case 12:
+            return matchKeyword(text, "greater_than", TokenType::TOK_GREATER);
+        case 13:
+            return matchKeyword(text, "less_or_equal", TokenType::TOK_LESS_EQ);
+        case 16:
+            return matchKeyword(text, "greater_or_equal", TokenType::TOK_GREATER_EQ);
+        }
+        return TokenType::TOK_IDENTIFIER;
     }
 
     // Convierte un TokenType a su cadena de representación
@@ -155,8 +240,19 @@ class TokenManager {
         }
         return "UNKNOWN_TOKEN";
     }
+
+  private:
+    static constexpr TokenType matchKeyword(std::string_view text, std::string_view keyword,
+                                            TokenType type) {
+        return text == keyword ? type : TokenType::TOK_IDENTIFIER;
+    }
 };
 
+static_assert(TokenManager::classifyIdentifier("repeat") == TokenType::TOK_REPEAT);
+static_assert(TokenManager::classifyIdentifier("return") == TokenType::TOK_RETURN);
+static_assert(TokenManager::classifyIdentifier("greater_or_equal") == TokenType::TOK_GREATER_EQ);
+static_assert(TokenManager::classifyIdentifier("iff") == TokenType::TOK_IDENTIFIER);
+
 } // namespace umbra
 
 #endif // TOKENS_H
@@ -1,68 +1,179 @@
-#include "ast/visitor/ASTVisitor.h"
+#include "ast/ASTDumper.h"
+#include "ast/ASTSerialization.h"
 #include "error/ErrorManager.h"
 #include "lexer/Lexer.h"
+#include "lexer/ParallelLexer.h"
+#include "lexer/TokenCache.h"
+#include "lexer/TokenPipeline.h"
 #include "parser/Parser.h"
-#include <fstream>
+#include "support/Trace.h"
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/raw_ostream.h>
 #include <iostream>
 #include <memory>
-#include <sstream>
-
-namespace umbra {
-
-std::string readFile(const std::string &filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Unable to open file: " + filename);
+#include <optional>
+
+namespace {
+
+llvm::cl::opt<std::string> inputFilename(llvm::cl::Positional, llvm::cl::desc("<source_file | ->"),
+                                         llvm::cl::Required);
+
+llvm::cl::opt<unsigned>
+    lexThreads("lex-threads",
+               llvm::cl::desc("Lex the input on N threads (1 = serial, 0 = all cores)"),
+               llvm::cl::init(1));
+
+llvm::cl::opt<std::string>
+    tokenCacheDir("token-cache",
+                  llvm::cl::desc("Reuse the tokens of unchanged sources from <dir> (.umbtok)"),
+                  llvm::cl::value_desc("dir"));
+
+llvm::cl::opt<std::string>
+    astCacheDir("ast-cache",
+                llvm::cl::desc("Reuse the trees of unchanged sources from <dir> (.umbast)"),
+                llvm::cl::value_desc("dir"));
+
+llvm::cl::opt<bool>
+    pipeline("pipeline", llvm::cl::desc("Lex and parse concurrently on two threads"));
+
+llvm::cl::opt<bool> uniqueExpressions(
+    "unique-expressions",
+    llvm::cl::desc("Allocate one shared node per distinct literal or identifier"));
+
+llvm::cl::opt<bool> dumpTokens("dump-tokens", llvm::cl::desc("Print the token stream"));
+
+llvm::cl::opt<bool> dumpAST("dump-ast", llvm::cl::desc("Print the abstract syntax tree"));
+
+llvm::cl::opt<umbra::ASTDumper::Format> astFormat(
+    "ast-format", llvm::cl::desc("Format of --dump-ast"),
+    llvm::cl::values(clEnumValN(umbra::ASTDumper::Format::Text, "text", "Indented text"),
+                     clEnumValN(umbra::ASTDumper::Format::JSON, "json", "JSON"),
+                     clEnumValN(umbra::ASTDumper::Format::DOT, "dot", "Graphviz digraph")),
+    llvm::cl::init(umbra::ASTDumper::Format::Text));
+
+llvm::cl::list<std::string>
+    traceCategories("trace", llvm::cl::desc("Trace compiler internals (lexer, parser, ast, all)"),
+                    llvm::cl::value_desc("category"), llvm::cl::CommaSeparated);
+
+// Enables the --trace categories; returns false on an unknown name
+bool setUpTracing() {
+    unsigned categories = 0;
+    for (const std::string &name : traceCategories) {
+        unsigned category = umbra::trace::parseCategory(name);
+        if (!category) {
+            llvm::errs() << "Unknown trace category: " << name << '\n';
+            return false;
+        }
+        categories |= category;
     }
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+    if (categories && !UMBRA_ENABLE_TRACE)
+        llvm::errs() << "warning: tracing was compiled out (UMBRA_ENABLE_TRACE=OFF)\n";
+    umbra::trace::enable(categories);
+    return true;
 }
 
-void printAST(ASTNode *node) {
-    PrintVisitor visitor;
-    node->accept(visitor);
+} // namespace
+
+// Streams the tree to stdout. llvm::outs() does not buffer a terminal, which
+// would turn every node into several write() calls, so give it a buffer.
+void dumpTree(umbra::ASTNode *node) {
+    llvm::raw_fd_ostream &out = llvm::outs();
+    out.SetBufferSize(1 << 16);
+    if (astFormat == umbra::ASTDumper::Format::Text)
+        out << "Abstract Syntax Tree:\n";
+    umbra::ASTDumper(out, astFormat).dump(node);
+    out.flush();
 }
 
-} // namespace umbra
-
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <source_file>" << std::endl;
+    llvm::cl::ParseCommandLineOptions(argc, argv, "Umbra compiler\n");
+    if (!setUpTracing())
+        return 1;
+    if (pipeline && (lexThreads != 1 || !tokenCacheDir.empty() || dumpTokens)) {
+        llvm::errs() << "--pipeline cannot be combined with --lex-threads, --token-cache or "
+                        "--dump-tokens\n";
+        return 1;
+    }
+    if (!astCacheDir.empty() && dumpTokens) {
+        llvm::errs() << "--ast-cache cannot be combined with --dump-tokens\n";
         return 1;
     }
 
     try {
-        std::string sourceCode = umbra::readFile(argv[1]);
+        umbra::SourceManager sourceManager;
+        const umbra::SourceBuffer *source = &sourceManager.loadFile(inputFilename);
         umbra::ErrorManager errorManager;
-        umbra::Lexer lexer(sourceCode, errorManager);
-
-        // Perform lexical analysis
-        auto tokens = lexer.tokenize();
-
-        // Print tokens (for debugging)
-        std::cout << "Tokens:" << std::endl;
-        for (const auto &token : tokens) {
-            std::cout << "Token: Type=" << lexer.tokenManager.tokenTypeToString(token.type)
-                      << ", Lexeme='";
-            if (token.type == umbra::TokenType::TOK_NEWLINE) {
-                std::cout << "\\n";
-            } else {
-                std::cout << token.lexeme;
+        errorManager.setSourceManager(&sourceManager);
+        umbra::Lexer lexer(*source, errorManager);
+
+        // A source that is unchanged since it last compiled cleanly maps its
+        // tree from the AST cache and is neither lexed nor parsed
+        umbra::ASTContext astContext;
+        astContext.setUniquing(uniqueExpressions);
+        std::optional<umbra::ASTCache> astCache;
+        std::unique_ptr<umbra::ASTReader> astReader;
+        if (!astCacheDir.empty()) {
+            astCache.emplace(astCacheDir);
+            astReader = astCache->load(*source, astContext);
+        }
+
+        // Perform lexical analysis up front, unless an identical source was
+        // already cached, or concurrently with parsing in pipeline mode
+        std::optional<umbra::TokenPipeline> tokenPipeline;
+        std::optional<umbra::TokenBuffer> tokens;
+        if (astReader) {
+            // Already parsed
+        } else if (pipeline) {
+            tokenPipeline.emplace(lexer);
+        } else {
+            std::optional<umbra::TokenCache> cache;
+            if (!tokenCacheDir.empty()) {
+                cache.emplace(tokenCacheDir);
+                tokens = cache->load(*source);
             }
-            std::cout << "', Line=" << token.line << ", Column=" << token.column << std::endl;
+            bool cached = tokens.has_value();
+            if (!cached && lexThreads == 1)
+                tokens.emplace(lexer.tokenize());
+            else if (!cached)
+                tokens.emplace(umbra::ParallelLexer(*source, errorManager, lexThreads).tokenize());
+            // Lexical errors are not cached, so only clean streams are stored
+            if (cache && !cached && !errorManager.hasErrors())
+                cache->store(*tokens);
         }
 
-        std::cout << "Lexical analysis completed" << std::endl;
+        if (dumpTokens) {
+            llvm::raw_ostream &out = llvm::outs();
+            out << "Tokens:\n";
+            for (const auto &token : *tokens) {
+                out << "Token: Type=" << lexer.tokenManager.tokenTypeToString(token.type)
+                    << ", Lexeme='";
+                if (token.type == umbra::TokenType::TOK_NEWLINE) {
+                    out << "\\n";
+                } else {
+                    out << llvm::StringRef(token.lexeme.data(), token.lexeme.size());
+                }
+                umbra::LineColumn position = source->getLineColumn(token.offset);
+                out << "', Line=" << position.line << ", Column=" << position.column << '\n';
+            }
+        }
 
-        // Perform parsing
-        umbra::Parser parser(tokens, errorManager);
-        std::unique_ptr<umbra::ASTNode> ast;
+        umbra::ProgramNode *ast = nullptr;
 
         try {
-            ast = parser.parse();
-            std::cout << "Parsing completed." << std::endl;
-
+            if (astReader) {
+                ast = astReader->getProgram();
+            } else {
+                // Perform parsing over the token buffer, without copying it
+                umbra::Parser parser = tokenPipeline
+                                           ? umbra::Parser(*tokenPipeline, errorManager)
+                                           : umbra::Parser(*tokens, errorManager);
+                ast = parser.parse(astContext);
+                // Both threads reported as they went; present errors in source order
+                if (tokenPipeline)
+                    errorManager.sortErrors();
+                if (astCache && !errorManager.hasErrors())
+                    astCache->store(*ast, *source);
+            }
             if (errorManager.hasErrors()) {
                 std::cerr << "Compilation failed. Errors:\n";
                 std::cerr << errorManager.getErrorReport();
@@ -70,9 +181,8 @@ int main(int argc, char *argv[]) {
                 std::cerr << "Compilation successfully.\n";
             }
 
-            // Print AST using our new PrintVisitor
-            std::cout << "Abstract Syntax Tree:" << std::endl;
-            umbra::printAST(ast.get());
+            if (dumpAST)
+                dumpTree(ast);
         } catch (const std::exception &e) {
             std::cerr << "Parsing failed. Error: " << e.what() << std::endl;
             return 1;
@@ -81,9 +191,11 @@ int main(int argc, char *argv[]) {
         // TODO: Add further stages of compilation here
 
     } catch (const std::exception &e) {
+        umbra::trace::flush();
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
 
+    umbra::trace::flush();
     return 0;
 }
\ No newline at end of file
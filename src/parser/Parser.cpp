@@ -1,30 +1,41 @@
 #include "Parser.h"
 #include "../ast/ProgramNode.h"
 #include "../lexer/TokensUtils.h"
-#include <iostream>
+#include "../support/Trace.h"
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/Support/Casting.h>
 #include <stdexcept>
 
 namespace umbra {
 
-// Parser::Parser(Lexer &lexer) : lexer(lexer) {}
-
-Parser::Parser(const std::vector<Lexer::Token> &tokens)
-    : tokens(tokens), current(tokens.begin()), errorManager(new ErrorManager()),
-      previousToken(*current) {}
+Parser::Parser(Lexer &lexer) : lexer(&lexer), errorManager(new ErrorManager()) {
+    errorManager->setSourceBuffer(&lexer.getSourceBuffer());
+}
 
 // Constructor que usa un ErrorManager externo
-Parser::Parser(const std::vector<Lexer::Token> &tokens, ErrorManager &externalErrorManager)
-    : tokens(tokens), current(tokens.begin()), errorManager(&externalErrorManager),
-      previousToken(*current) {}
+Parser::Parser(Lexer &lexer, ErrorManager &externalErrorManager)
+    : lexer(&lexer), errorManager(&externalErrorManager) {}
+
+Parser::Parser(const TokenBuffer &tokens)
+    : tokens(&tokens), errorManager(new ErrorManager()), currentToken(tokens[0]) {
+    errorManager->setSourceBuffer(&tokens.getSourceBuffer());
+}
+
+Parser::Parser(const TokenBuffer &tokens, ErrorManager &externalErrorManager)
+    : tokens(&tokens), errorManager(&externalErrorManager), currentToken(tokens[0]) {}
 
-std::unique_ptr<ASTNode> Parser::parse() {
-    std::vector<std::unique_ptr<ASTNode>> ast;
+Parser::Parser(TokenPipeline &pipeline, ErrorManager &externalErrorManager)
+    : pipeline(&pipeline), errorManager(&externalErrorManager) {}
+
+ProgramNode *Parser::parse(ASTContext &astContext) {
+    context = &astContext;
+    llvm::SmallVector<ASTNode *, 64> ast;
 
     while (!isAtEnd()) {
         try {
             ast.push_back(parseStatement());
         } catch (const std::exception &e) {
-            std::cerr << "Error: " << e.what() << std::endl;
+            UMBRA_TRACE(Parser, "recovering after: " << e.what());
             // Skip to the next newline or EOF
             while (!isAtEnd() && !match(TokenType::TOK_NEWLINE)) {
                 advance();
@@ -32,7 +43,8 @@ std::unique_ptr<ASTNode> Parser::parse() {
         }
     }
 
-    return std::make_unique<ProgramNode>(std::move(ast));
+    UMBRA_TRACE(AST, "ProgramNode with " << ast.size() << " statements");
+    return context->create<ProgramNode>(context->copyArray<ASTNode *>(ast));
 }
 
 /*types */
@@ -51,57 +63,66 @@ bool Parser::isTypeSpecifier(TokenType type) const {
 }
 
 TokenType Parser::parseTypeSpecifier() {
-    if (isTypeSpecifier(peek().type)) {
-        TokenType type = peek().type;
+    if (isTypeSpecifier(peekType())) {
+        TokenType type = peekType();
         advance(); // Consumir el token de tipo
         return type;
     } else {
-        throw std::runtime_error("Expected type specifier, but found: " +
-                                 TokenManager::tokenTypeToString(peek().type));
+        std::string errorMsg =
+            "Expected type specifier, but found: " + TokenManager::tokenTypeToString(peekType());
+        errorManager->addError(
+            std::make_unique<CompilerError>(ErrorType::SYNTACTIC, errorMsg, locationOf(peek())));
+        throw std::runtime_error(errorMsg);
     }
 }
 
 /*Statements*/
-std::unique_ptr<ASTNode> Parser::parseStatement() {
+ASTNode *Parser::parseStatement() {
+    UMBRA_TRACE(Parser, "statement at offset " << peek().offset << ": "
+                                               << TokenManager::tokenTypeToString(peekType()));
 
     // some TOK_* type
-    if (isTypeSpecifier(peek().type)) {
+    if (isTypeSpecifier(peekType())) {
         return parseVariableDeclaration();
     }
 
-    switch (peek().type) {
+    switch (peekType()) {
     case TokenType::TOK_IF:
         return nullptr; // parseIfStatement();
     // Otros casos de declaraciones, como bucles, llamadas a funciones, etc.
     default:
-        throw std::runtime_error("Unexpected token: " +
-                                 TokenManager::tokenTypeToString(peek().type));
+        std::string errorMsg = "Unexpected token: " + TokenManager::tokenTypeToString(peekType());
+        errorManager->addError(
+            std::make_unique<CompilerError>(ErrorType::SYNTACTIC, errorMsg, locationOf(peek())));
+        throw std::runtime_error(errorMsg);
     }
 }
 
 bool Parser::isTypeCompatible(TokenType declaredType, ExpressionNode *expr) {
     if (declaredType == TokenType::TOK_INT) {
-        return dynamic_cast<ex_IntegerLiteralNode *>(expr) != nullptr;
+        return llvm::isa<ex_IntegerLiteralNode>(expr);
     } else if (declaredType == TokenType::TOK_FLOAT) {
-        return dynamic_cast<ex_FloatLiteralNode *>(expr) != nullptr ||
-               dynamic_cast<ex_IntegerLiteralNode *>(expr) != nullptr;
+        return llvm::isa<ex_FloatLiteralNode, ex_IntegerLiteralNode>(expr);
     } else if (declaredType == TokenType::TOK_STRING) {
-        return dynamic_cast<ex_StringLiteralNode *>(expr) != nullptr;
+        return llvm::isa<ex_StringLiteralNode>(expr);
     }
     // Handle other types...
     return false;
 }
 
 std::string Parser::getExpressionTypeName(ExpressionNode *expr) {
-    if (dynamic_cast<ex_IntegerLiteralNode *>(expr))
+    switch (expr->getKind()) {
+    case ASTNode::Kind::IntegerLiteral:
         return "int";
-    if (dynamic_cast<ex_FloatLiteralNode *>(expr))
+    case ASTNode::Kind::FloatLiteral:
         return "float";
-    if (dynamic_cast<ex_BoolLiteralNode *>(expr))
+    case ASTNode::Kind::BoolLiteral:
         return "bool";
-    if (dynamic_cast<ex_StringLiteralNode *>(expr))
+    case ASTNode::Kind::StringLiteral:
         return "string";
-    return "unknown";
+    default:
+        return "unknown";
+    }
 }
 
 std::string Parser::getTypeName(TokenType type) {
@@ -117,68 +138,40 @@ std::string Parser::getTypeName(TokenType type) {
     return "unknown";
 }
 
-std::unique_ptr<ExpressionNode> Parser::parseNumber(const Lexer::Token &token) {
+ExpressionNode *Parser::parseNumber(const Lexer::Token &token) {
     /*
       TODO: not support to hexa, octal?
      */
-    const std::string &lexeme = token.lexeme;
-    try {
-        // entero
-        size_t pos;
-        long long intValue = std::stoll(lexeme, &pos);
-        if (pos == lexeme.length()) {
-            return std::make_unique<ex_IntegerLiteralNode>(static_cast<int>(intValue));
-        }
-        double doubleValue = std::stod(lexeme);
-        return std::make_unique<ex_FloatLiteralNode>(doubleValue);
-    } catch (const std::out_of_range &e) {
-        try {
-            double doubleValue = std::stod(lexeme);
-            return std::make_unique<ex_FloatLiteralNode>(doubleValue);
-        } catch (const std::out_of_range &e) {
-            throw std::runtime_error("Number out of range: " + lexeme);
-        }
-    } catch (const std::invalid_argument &e) {
-        // not a number token!
-        throw std::runtime_error("Invalid number format: " + lexeme);
-    }
+    // The lexer already decoded the value (and diagnosed overflow)
+    if (token.isFloat())
+        return context->getFloatLiteral(token.value.real);
+    return context->getIntegerLiteral(token.value.integer);
 }
 
-std::unique_ptr<ExpressionNode> Parser::parseExpression() {
-    Lexer::Token currentToken = peek();
-
-    switch (currentToken.type) {
-    case TokenType::TOK_NUMBER: {
-        advance();
-        return parseNumber(currentToken);
-    }
+ExpressionNode *Parser::parseExpression() {
+    switch (peekType()) {
+    case TokenType::TOK_NUMBER:
+        return parseNumber(advance());
 
-    case TokenType::TOK_STRING_LITERAL: {
-        advance();
-        return std::make_unique<ex_StringLiteralNode>(currentToken.lexeme);
-    }
+    case TokenType::TOK_STRING_LITERAL:
+        return context->getStringLiteral(advance().lexeme);
 
     case TokenType::TOK_BOOL: {
-        advance();
-        bool boolValue = (currentToken.lexeme == "true");
-        return std::make_unique<ex_BoolLiteralNode>(boolValue);
+        bool boolValue = (advance().lexeme == "true");
+        return context->getBoolLiteral(boolValue);
     }
 
-    case TokenType::TOK_IDENTIFIER: {
-        advance();
-        return std::make_unique<ex_IdentifierNode>(currentToken.lexeme);
-    }
+    case TokenType::TOK_IDENTIFIER:
+        return context->getIdentifier(advance().value.symbol);
 
-    case TokenType::TOK_CHAR_LITERAL: {
-        advance();
-        return std::make_unique<ex_CharLiteralNode>(currentToken.lexeme);
-    }
+    case TokenType::TOK_CHAR_LITERAL:
+        return context->getCharLiteral(advance().lexeme);
 
     default:
         std::string errorMsg =
-            "Unexpected token in expression: " + TokenManager::tokenTypeToString(currentToken.type);
-        errorManager->addError(std::make_unique<CompilerError>(
-            ErrorType::SYNTACTIC, errorMsg, currentToken.line, currentToken.column));
+            "Unexpected token in expression: " + TokenManager::tokenTypeToString(peekType());
+        errorManager->addError(
+            std::make_unique<CompilerError>(ErrorType::SYNTACTIC, errorMsg, locationOf(peek())));
         // throw std::runtime_error(errorMsg);
         return nullptr;
     }
@@ -186,7 +179,7 @@ std::unique_ptr<ExpressionNode> Parser::parseExpression() {
     return nullptr;
 }
 
-std::unique_ptr<st_VariableDeclNode> Parser::parseVariableDeclaration() {
+st_VariableDeclNode *Parser::parseVariableDeclaration() {
     /*
     <variable_declaration> ::= <type> [ "[" <array_size> "]" ] <identifier> ["=" <expression>]
     <newline> <array_size> ::= <const> | <identifier>
@@ -196,64 +189,66 @@ std::unique_ptr<st_VariableDeclNode> Parser::parseVariableDeclaration() {
     TokenType type = parseTypeSpecifier();
 
     // array?
-    std::unique_ptr<ExpressionNode> arraySize = nullptr;
+    ExpressionNode *arraySize = nullptr;
     if (match(TokenType::TOK_LEFT_BRACKET)) {
-        if (peek().type == TokenType::TOK_NUMBER || peek().type == TokenType::TOK_IDENTIFIER) {
+        if (peekType() == TokenType::TOK_NUMBER || peekType() == TokenType::TOK_IDENTIFIER) {
             arraySize = parseExpression();
         } else {
             std::string errorMsg = "Expected constant or identifier for array size.";
-            errorManager->addError(std::make_unique<CompilerError>(ErrorType::SYNTACTIC, errorMsg,
-                                                                   peek().line, peek().column));
+            errorManager->addError(
+                std::make_unique<CompilerError>(ErrorType::SYNTACTIC, errorMsg,
+                                                locationOf(peek())));
             throw std::runtime_error(errorMsg);
         }
         consume(TokenType::TOK_RIGHT_BRACKET, "Expected ']' after array size.");
     }
 
     // name (TOK_IDENTIFIER)
-    auto token = consume(TokenType::TOK_IDENTIFIER, "Expected variable name");
-    std::string name = token.lexeme;
+    Symbol name = consume(TokenType::TOK_IDENTIFIER, "Expected variable name").value.symbol;
 
     // initializer?
-    std::unique_ptr<ExpressionNode> initializer = nullptr;
+    ExpressionNode *initializer = nullptr;
     if (match(TokenType::TOK_ASSIGN)) {
         initializer = parseExpression();
         if (initializer) {
-            if (!isTypeCompatible(type, initializer.get())) {
+            if (!isTypeCompatible(type, initializer)) {
                 std::string errorMsg =
-                    "Type mismatch in initialization of '" + name + "'. Cannot convert from " +
-                    getExpressionTypeName(initializer.get()) + " to " + getTypeName(type);
+                    "Type mismatch in initialization of '" + std::string(name.str()) +
+                    "'. Cannot convert from " +
+                    getExpressionTypeName(initializer) + " to " + getTypeName(type);
                 errorManager->addError(std::make_unique<CompilerError>(
-                    ErrorType::SEMANTIC, errorMsg, previous().line, previous().column));
+                    ErrorType::SEMANTIC, errorMsg, locationOf(previous())));
             }
         } else {
             std::string errorMsg = "Expected expression after '=' in variable declaration.";
-            errorManager->addError(std::make_unique<CompilerError>(ErrorType::SYNTACTIC, errorMsg,
-                                                                   peek().line, peek().column));
+            errorManager->addError(
+                std::make_unique<CompilerError>(ErrorType::SYNTACTIC, errorMsg,
+                                                locationOf(peek())));
         }
     }
 
     // TOK_NEWLINE
     if (!match(TokenType::TOK_NEWLINE)) {
         std::string errorMsg = "Expected newline after variable declaration.";
-        errorManager->addError(std::make_unique<CompilerError>(ErrorType::SYNTACTIC, errorMsg,
-                                                               peek().line, peek().column));
+        errorManager->addError(
+            std::make_unique<CompilerError>(ErrorType::SYNTACTIC, errorMsg, locationOf(peek())));
         throw std::runtime_error(errorMsg);
     }
-    return std::make_unique<st_VariableDeclNode>(type, name, std::move(initializer),
-                                                 std::move(arraySize));
+    UMBRA_TRACE(AST, "VariableDeclaration '" << trace::escaped(name.str()) << "'");
+    return context->create<st_VariableDeclNode>(type, name, initializer, arraySize);
 }
 
 /*
-std::unique_ptr<FunctionDeclNode> Parser::parseFunctionDefinition() {
+FunctionDeclNode *Parser::parseFunctionDefinition() {
     consume(TokenType::TOK_FUNC, "Expected 'func' at the beginning of function definition");
 
     // Parse the function name (identifier)
     auto token = consume(TokenType::TOK_IDENTIFIER, "Expected function name");
-    std::string functionName = token.lexeme;
+    Symbol functionName = token.value.symbol;
 
     // Parse the parameter list
     consume(TokenType::TOK_LEFT_PAREN, "Expected '(' after function name");
-    std::vector<std::unique_ptr<ParameterNode>> parameters = parseParameterList();
+    llvm::ArrayRef<ParameterNode *> parameters = parseParameterList();
     consume(TokenType::TOK_RIGHT_PAREN, "Expected ')' after parameter list");
 
     // Parse the return type (after '->')
@@ -263,7 +258,7 @@ std::unique_ptr<FunctionDeclNode> Parser::parseFunctionDefinition() {
     // Parse the function body (statements inside braces)
     consume(TokenType::TOK_LEFT_BRACE, "Expected '{' at the beginning of function body");
 
-    std::vector<std::unique_ptr<ASTNode>> body;
+    llvm::SmallVector<ASTNode *, 16> body;
     while (!check(TokenType::TOK_RIGHT_BRACE) && !isAtEnd()) {
         body.push_back(parseStatement());
     }
@@ -271,13 +266,13 @@ std::unique_ptr<FunctionDeclNode> Parser::parseFunctionDefinition() {
     consume(TokenType::TOK_RIGHT_BRACE, "Expected '}' at the end of function body");
 
     // Return statement if the function is not void
-    std::unique_ptr<ReturnStatementNode> returnStmt = nullptr;
+    ReturnStatementNode *returnStmt = nullptr;
     if (returnType != TokenType::TOK_VOID && match(TokenType::TOK_RETURN)) {
         returnStmt = parseReturnStatement();
     }
 
-    return std::make_unique<FunctionDeclNode>(functionName, std::move(parameters), returnType,
-                                              std::move(body), std::move(returnStmt));
+    return context->create<FunctionDeclNode>(functionName, parameters, returnType,
+                                             context->copyArray<ASTNode *>(body), returnStmt);
 }
 */
 /*Expression*/
@@ -295,32 +290,51 @@ bool Parser::match(TokenType type) {
 bool Parser::check(TokenType type) const {
     if (isAtEnd())
         return false;
-    return peek().type == type;
+    return peekType() == type;
 }
 
-Lexer::Token Parser::advance() {
-    if (!isAtEnd()) {
-        previousToken = *current;
-        ++current;
+// Type-only lookahead: in buffer mode this reads the dense kind array
+TokenType Parser::peekType() const {
+    if (tokens)
+        return tokens->kind(index);
+    return pipeline ? pipeline->peek().type : lexer->peek().type;
+}
+
+const Lexer::Token &Parser::advance() {
+    if (isAtEnd())
+        return previous();
+    if (tokens) {
+        previousToken = currentToken;
+        currentToken = (*tokens)[++index];
+    } else {
+        previousToken = pipeline ? pipeline->next() : lexer->next();
     }
     return previous();
 }
 
-Lexer::Token Parser::previous() const { return previousToken; }
-
-Lexer::Token Parser::peek() const { return *current; }
+SourceLocation Parser::locationOf(const Lexer::Token &token) const {
+    const SourceBuffer &buffer = tokens     ? tokens->getSourceBuffer()
+                                 : pipeline ? pipeline->getSourceBuffer()
+                                            : lexer->getSourceBuffer();
+    return buffer.getLocation(token.offset);
+}
 
-bool Parser::isAtEnd() const { return peek().type == TokenType::TOK_EOF; }
+const Lexer::Token &Parser::previous() const { return previousToken; }
 
-Lexer::Token Parser::consume(TokenType type, const std::string &message) {
-    Lexer::Token currentToken = peek();
-    if (check(type)) {
-        advance();
+const Lexer::Token &Parser::peek() const {
+    if (tokens)
         return currentToken;
-    }
-    errorManager->addError(
-        std::make_unique<CompilerError>(ErrorType::SYNTACTIC, message, peek().line, peek().column));
-    throw std::runtime_error(message);
+    return pipeline ? pipeline->peek() : lexer->peek();
+}
+
+bool Parser::isAtEnd() const { return peekType() == TokenType::TOK_EOF; }
+
+const Lexer::Token &Parser::consume(TokenType type, std::string_view message) {
+    if (check(type))
+        return advance();
+    errorManager->addError(std::make_unique<CompilerError>(
+        ErrorType::SYNTACTIC, std::string(message), locationOf(peek())));
+    throw std::runtime_error(std::string(message));
 }
 
 } // namespace umbra
\ No newline at end of file
@@ -1,42 +1,67 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include "../ast/ASTContext.h"
 #include "../ast/ASTNode.h"
+#include "../ast/ProgramNode.h"
 #include "../ast/statementnodes/StatementNode.h"
 #include "../lexer/Lexer.h"
+#include "../lexer/TokenPipeline.h"
 #include <memory>
+#include <string_view>
 #include <vector>
 
 namespace umbra {
 
 class Parser {
   public:
-    // Parser(Lexer &lexer);
-    Parser(const std::vector<Lexer::Token> &tokens);
-    Parser(const std::vector<Lexer::Token> &tokens, ErrorManager &externalErrorManager);
+    // The parser pulls tokens from the lexer on demand; only the lexer's small
+    // lookahead window is ever held in memory.
+    Parser(Lexer &lexer);
+    Parser(Lexer &lexer, ErrorManager &externalErrorManager);
+    // Parses an already tokenized buffer in place; the buffer must outlive the
+    // parser and is never copied.
+    Parser(const TokenBuffer &tokens);
+    Parser(const TokenBuffer &tokens, ErrorManager &externalErrorManager);
+    // Consumes tokens while the pipeline's lexer thread is still producing
+    // them; `externalErrorManager` must be the one the lexer reports to.
+    Parser(TokenPipeline &pipeline, ErrorManager &externalErrorManager);
 
-    std::unique_ptr<ASTNode> parse();
+    // Builds the tree in `astContext`, which owns every node and must outlive
+    // the returned program
+    ProgramNode *parse(ASTContext &astContext);
 
   private:
-    // Lexer &lexer;
-    std::vector<Lexer::Token> tokens;
-    std::vector<Lexer::Token>::const_iterator current;
+    // Exactly one token source is set
+    Lexer *lexer = nullptr;
+    const TokenBuffer *tokens = nullptr;
+    TokenPipeline *pipeline = nullptr;
+    size_t index = 0;
     ErrorManager *errorManager;
+    ASTContext *context = nullptr;
+    // Tokens are trivially copyable views into the source, so keeping these
+    // two never allocates. currentToken is only used with a TokenBuffer, whose
+    // structure-of-arrays layout has no Token object to refer to.
+    Lexer::Token currentToken;
     Lexer::Token previousToken;
 
     bool match(TokenType type);
     bool check(TokenType type) const;
-    Lexer::Token advance();
-    Lexer::Token previous() const;
-    Lexer::Token peek() const;
+    TokenType peekType() const;
+    SourceLocation locationOf(const Lexer::Token &token) const;
+    // The references stay valid until the next advance()
+    const Lexer::Token &advance();
+    const Lexer::Token &previous() const;
+    const Lexer::Token &peek() const;
     bool isAtEnd() const;
-    Lexer::Token consume(TokenType type, const std::string &message);
+    // The message is only copied into a diagnostic when the check fails
+    const Lexer::Token &consume(TokenType type, std::string_view message);
 
-    std::unique_ptr<ASTNode> parseStatement();
-    std::unique_ptr<ExpressionNode> parseNumber(const Lexer::Token &token);
-    std::unique_ptr<st_VariableDeclNode> parseVariableDeclaration();
-    std::unique_ptr<FunctionDeclNode> parseFunctionDefinition();
-    std::unique_ptr<ExpressionNode> parseExpression();
+    ASTNode *parseStatement();
+    ExpressionNode *parseNumber(const Lexer::Token &token);
+    st_VariableDeclNode *parseVariableDeclaration();
+    FunctionDeclNode *parseFunctionDefinition();
+    ExpressionNode *parseExpression();
     TokenType parseTypeSpecifier();
     bool isTypeSpecifier(TokenType type) const;
     bool isTypeCompatible(TokenType declaredType, ExpressionNode *expr);
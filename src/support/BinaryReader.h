@@ -0,0 +1,83 @@
+#ifndef UMBRA_BINARY_READER_H
+#define UMBRA_BINARY_READER_H
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/LEB128.h>
+#include <cstdint>
+
+namespace umbra {
+
+// Signed integers are written as ULEB128 of their zigzag encoding, so small
+// negative values stay short
+inline uint64_t zigzagEncode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Bounds-checked cursor over an on-disk entry (.umbtok, .umbast). Any read
+// past the end sets `failed` and returns zero, so a decoder can read a whole
+// record and check once.
+class BinaryReader {
+  public:
+    explicit BinaryReader(llvm::StringRef data)
+        : begin(data.bytes_begin()), p(data.bytes_begin()), end(data.bytes_end()) {}
+
+    bool failed = false;
+
+    bool atEnd() const { return p == end; }
+    // Bytes consumed so far
+    uint64_t tell() const { return static_cast<uint64_t>(p - begin); }
+
+    uint8_t byte() {
+        if (p == end) {
+            failed = true;
+            return 0;
+        }
+        return *p++;
+    }
+
+    uint64_t uleb() {
+        unsigned length = 0;
+        const char *error = nullptr;
+        uint64_t value = llvm::decodeULEB128(p, &length, end, &error);
+        if (error) {
+            failed = true;
+            return 0;
+        }
+        p += length;
+        return value;
+    }
+
+    uint64_t u64() {
+        if (end - p < 8) {
+            failed = true;
+            return 0;
+        }
+        uint64_t value = llvm::support::endian::read64le(p);
+        p += 8;
+        return value;
+    }
+
+    llvm::StringRef bytes(uint64_t count) {
+        if (static_cast<uint64_t>(end - p) < count) {
+            failed = true;
+            return {};
+        }
+        llvm::StringRef text(reinterpret_cast<const char *>(p), count);
+        p += count;
+        return text;
+    }
+
+  private:
+    const uint8_t *begin;
+    const uint8_t *p;
+    const uint8_t *end;
+};
+
+} // namespace umbra
+
+#endif // UMBRA_BINARY_READER_H
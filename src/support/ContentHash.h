@@ -0,0 +1,19 @@
+#ifndef UMBRA_CONTENT_HASH_H
+#define UMBRA_CONTENT_HASH_H
+
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/xxhash.h>
+#include <cstdint>
+#include <string_view>
+
+namespace umbra {
+
+// xxHash64 of a source's bytes. The on-disk caches (.umbtok, .umbast) are
+// named and validated by it, so it must not change between releases.
+inline uint64_t contentHash(std::string_view bytes) {
+    return llvm::xxHash64(llvm::StringRef(bytes.data(), bytes.size()));
+}
+
+} // namespace umbra
+
+#endif // UMBRA_CONTENT_HASH_H
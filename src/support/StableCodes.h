@@ -0,0 +1,59 @@
+#ifndef UMBRA_STABLE_CODES_H
+#define UMBRA_STABLE_CODES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace umbra {
+
+// Fixed numbering of a byte-sized enum for on-disk formats and persistent
+// hashes. A value's code is its position in the table it is built from, not
+// its position in the enum, so the enum can be reordered freely; the table
+// itself is append-only, and removing or reordering entries needs a format
+// version bump. Both directions are a single array lookup.
+template <typename Enum, size_t N> class StableCodes {
+    static_assert(std::is_same<std::underlying_type_t<Enum>, uint8_t>::value,
+                  "codes are indexed by the enum's byte value");
+    static_assert(N < 256, "0xff is reserved for values without a code");
+
+  public:
+    static constexpr uint8_t INVALID = 0xff;
+
+    constexpr explicit StableCodes(const Enum (&table)[N]) {
+        for (size_t i = 0; i < 256; ++i)
+            codes[i] = INVALID;
+        for (size_t i = 0; i < N; ++i) {
+            values[i] = table[i];
+            codes[static_cast<uint8_t>(table[i])] = static_cast<uint8_t>(i);
+        }
+    }
+
+    // INVALID for a value missing from the table
+    constexpr uint8_t encode(Enum value) const { return codes[static_cast<uint8_t>(value)]; }
+    // False for a code outside the table
+    constexpr bool decode(uint8_t code, Enum &value) const {
+        if (code >= N)
+            return false;
+        value = values[code];
+        return true;
+    }
+
+    static constexpr size_t size() { return N; }
+    // True if every value in the table appears once and `count` values, the
+    // whole enum, are covered; for static_asserts next to the table
+    constexpr bool covers(size_t count) const {
+        size_t coded = 0;
+        for (size_t i = 0; i < 256; ++i)
+            coded += codes[i] != INVALID;
+        return coded == N && N == count;
+    }
+
+  private:
+    Enum values[N]{};
+    uint8_t codes[256]{};
+};
+
+} // namespace umbra
+
+#endif // UMBRA_STABLE_CODES_H
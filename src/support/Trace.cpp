@@ -0,0 +1,72 @@
+#include "Trace.h"
+#include <mutex>
+#include <unistd.h>
+
+namespace umbra {
+namespace trace {
+
+unsigned enabledCategories = 0;
+
+namespace {
+
+std::mutex sinkMutex;
+llvm::raw_ostream *customSink = nullptr;
+
+// Unlike llvm::errs() this stream is buffered; it is flushed on exit
+llvm::raw_ostream &defaultSink() {
+    static llvm::raw_fd_ostream sink(STDERR_FILENO, /*shouldClose=*/false, /*unbuffered=*/false);
+    return sink;
+}
+
+llvm::raw_ostream &sink() { return customSink ? *customSink : defaultSink(); }
+
+llvm::StringRef categoryName(Category category) {
+    switch (category) {
+    case Lexer:
+        return "lexer";
+    case Parser:
+        return "parser";
+    case AST:
+        return "ast";
+    default:
+        return "trace";
+    }
+}
+
+} // namespace
+
+void enable(unsigned categories) { enabledCategories = categories & All; }
+
+unsigned parseCategory(llvm::StringRef name) {
+    if (name.equals_insensitive("lexer"))
+        return Lexer;
+    if (name.equals_insensitive("parser"))
+        return Parser;
+    if (name.equals_insensitive("ast"))
+        return AST;
+    if (name.equals_insensitive("all"))
+        return All;
+    return 0;
+}
+
+void setSink(llvm::raw_ostream *newSink) {
+    std::lock_guard<std::mutex> lock(sinkMutex);
+    sink().flush();
+    customSink = newSink;
+}
+
+void flush() {
+    std::lock_guard<std::mutex> lock(sinkMutex);
+    sink().flush();
+}
+
+Line::Line(Category category) { os << "[" << categoryName(category) << "] "; }
+
+Line::~Line() {
+    os << '\n';
+    std::lock_guard<std::mutex> lock(sinkMutex);
+    sink() << text;
+}
+
+} // namespace trace
+} // namespace umbra
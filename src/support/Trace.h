@@ -0,0 +1,83 @@
+#ifndef UMBRA_TRACE_H
+#define UMBRA_TRACE_H
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Compiler.h>
+#include <llvm/Support/raw_ostream.h>
+#include <string_view>
+
+// Debug tracing by category. With UMBRA_ENABLE_TRACE=0 every UMBRA_TRACE
+// expands to nothing and its arguments are never evaluated. Otherwise a trace
+// point costs one load and a branch on the category mask until that category
+// is switched on (e.g. with --trace=lexer).
+//
+//   UMBRA_TRACE(Lexer, "token " << lexeme << " @" << offset);
+//
+// Lines are formatted on the calling thread and appended to a buffered sink
+// (stderr by default) under a lock, so traces from the parallel lexer do not
+// interleave mid-line.
+#ifndef UMBRA_ENABLE_TRACE
+#define UMBRA_ENABLE_TRACE 0
+#endif
+
+namespace umbra {
+namespace trace {
+
+enum Category : unsigned {
+    Lexer = 1u << 0,
+    Parser = 1u << 1,
+    AST = 1u << 2,
+    All = Lexer | Parser | AST,
+};
+
+extern unsigned enabledCategories;
+
+inline bool isEnabled(Category category) { return enabledCategories & category; }
+void enable(unsigned categories);
+// Parses "lexer", "parser", "ast" or "all"; returns 0 for an unknown name
+unsigned parseCategory(llvm::StringRef name);
+
+// Redirects the output; the sink must outlive tracing. nullptr restores stderr.
+void setSink(llvm::raw_ostream *sink);
+void flush();
+
+// Streams text with control characters escaped, so a lexeme such as "\n"
+// stays on its trace line
+struct Escaped {
+    llvm::StringRef text;
+};
+inline Escaped escaped(std::string_view text) { return {{text.data(), text.size()}}; }
+inline llvm::raw_ostream &operator<<(llvm::raw_ostream &os, Escaped value) {
+    os.write_escaped(value.text);
+    return os;
+}
+
+// One trace line, written to the sink when it goes out of scope
+class Line {
+  public:
+    explicit Line(Category category);
+    ~Line();
+    llvm::raw_ostream &stream() { return os; }
+
+  private:
+    llvm::SmallString<128> text;
+    llvm::raw_svector_ostream os{text};
+};
+
+} // namespace trace
+} // namespace umbra
+
+#if UMBRA_ENABLE_TRACE
+#define UMBRA_TRACE(category, message)                                                             \
+    do {                                                                                           \
+        if (LLVM_UNLIKELY(::umbra::trace::isEnabled(::umbra::trace::category)))                    \
+            ::umbra::trace::Line(::umbra::trace::category).stream() << message;                    \
+    } while (0)
+#else
+#define UMBRA_TRACE(category, message)                                                             \
+    do {                                                                                           \
+    } while (0)
+#endif
+
+#endif // UMBRA_TRACE_H
@@ -1,6 +1,17 @@
+#include "../src/lexer/CharScan.h"
 #include "../src/lexer/Lexer.h"
+#include "../src/lexer/ParallelLexer.h"
+#include "../src/lexer/SourceManager.h"
+#include "../src/lexer/SymbolTable.h"
+#include "../src/lexer/TokenCache.h"
+#include "../src/lexer/TokenPipeline.h"
 #include "../src/lexer/Tokens.h"
+#include "../src/support/Trace.h"
 #include <gtest/gtest.h>
+#include <llvm/Support/FileSystem.h>
+#include <iterator>
+#include <random>
+#include <thread>
 #include <vector>
 
 namespace umbra {
@@ -9,9 +20,9 @@ namespace umbra {
 
 // Prueba de tokenización básica para un programa simple
 TEST(LexerTest, TokenizeSimpleAssignment) {
-    std::string source = "int x = 10";
+    SourceBuffer source("int x = 10");
     Lexer lexer(source);
-    std::vector<Lexer::Token> tokens = lexer.tokenize();
+    TokenBuffer tokens = lexer.tokenize();
 
     ASSERT_EQ(tokens.size(), 5); // Deben ser 5 tokens (int, identifier, =, number, EOF)
 
@@ -26,9 +37,9 @@ TEST(LexerTest, TokenizeSimpleAssignment) {
 
 // Prueba de operadores aritméticos
 TEST(LexerTest, TokenizeArithmeticOperations_ValidateAllTokens) {
-    std::string source = "float a = 5.0 float b = 3.0 float result = a + b * 2";
+    SourceBuffer source("float a = 5.0 float b = 3.0 float result = a + b * 2");
     Lexer lexer(source);
-    std::vector<Lexer::Token> tokens = lexer.tokenize();
+    TokenBuffer tokens = lexer.tokenize();
 
     // El número total de tokens debería ser 17
     ASSERT_EQ(tokens.size(), 17); // 17 tokens en total
@@ -71,9 +82,9 @@ TEST(LexerTest, TokenizeArithmeticOperations_ValidateAllTokens) {
 
 // Prueba de control de flujo con if/else
 TEST(LexerTest, TokenizeIfElseControlFlow) {
-    std::string source = "bool flag = true if flag { int x = 1 } else { int x = 2 }";
+    SourceBuffer source("bool flag = true if flag { int x = 1 } else { int x = 2 }");
     Lexer lexer(source);
-    std::vector<Lexer::Token> tokens = lexer.tokenize();
+    TokenBuffer tokens = lexer.tokenize();
 
     ASSERT_EQ(tokens.size(), 20); // 20 tokens en total
 
@@ -88,9 +99,9 @@ TEST(LexerTest, TokenizeIfElseControlFlow) {
 
 // Prueba de una función con retorno
 TEST(LexerTest, TokenizeFunctionWithReturn) {
-    std::string source = "func add(int a, int b) -> int { return a + b }";
+    SourceBuffer source("func add(int a, int b) -> int { return a + b }");
     Lexer lexer(source);
-    std::vector<Lexer::Token> tokens = lexer.tokenize();
+    TokenBuffer tokens = lexer.tokenize();
 
     ASSERT_EQ(tokens.size(), 18); // 18 tokens en total
 
@@ -103,9 +114,9 @@ TEST(LexerTest, TokenizeFunctionWithReturn) {
 
 // Prueba de un bucle repeat
 TEST(LexerTest, TokenizeRepeatLoop) {
-    std::string source = "int sum = 0 repeat 10 times { sum = sum + 1 }";
+    SourceBuffer source("int sum = 0 repeat 10 times { sum = sum + 1 }");
     Lexer lexer(source);
-    std::vector<Lexer::Token> tokens = lexer.tokenize();
+    TokenBuffer tokens = lexer.tokenize();
 
     ASSERT_EQ(tokens.size(), 15); // 16 tokens en total
 
@@ -118,9 +129,9 @@ TEST(LexerTest, TokenizeRepeatLoop) {
 
 // Prueba de comparación entre valores
 TEST(LexerTest, TokenizeComparisonBetweenValues) {
-    std::string source = "int a = 5 int b = 10 if a less_than b { return a } else { return b }";
+    SourceBuffer source("int a = 5 int b = 10 if a less_than b { return a } else { return b }");
     Lexer lexer(source);
-    std::vector<Lexer::Token> tokens = lexer.tokenize();
+    TokenBuffer tokens = lexer.tokenize();
 
     ASSERT_EQ(tokens.size(), 22); // 21 tokens en total
 
@@ -132,9 +143,9 @@ TEST(LexerTest, TokenizeComparisonBetweenValues) {
 
 // Prueba de operadores lógicos
 TEST(LexerTest, TokenizeLogicalOperators) {
-    std::string source = "bool condition = (a greater_than b) and (b less_or_equal 10)";
+    SourceBuffer source("bool condition = (a greater_than b) and (b less_or_equal 10)");
     Lexer lexer(source);
-    std::vector<Lexer::Token> tokens = lexer.tokenize();
+    TokenBuffer tokens = lexer.tokenize();
 
     ASSERT_EQ(tokens.size(), 15); // 17 tokens en total
 
@@ -146,9 +157,9 @@ TEST(LexerTest, TokenizeLogicalOperators) {
 
 // Prueba de operaciones sobre cadenas
 TEST(LexerTest, TokenizeStringOperations) {
-    std::string source = "string message = \"hello\" message = message + \" world\"";
+    SourceBuffer source("string message = \"hello\" message = message + \" world\"");
     Lexer lexer(source);
-    std::vector<Lexer::Token> tokens = lexer.tokenize();
+    TokenBuffer tokens = lexer.tokenize();
 
     ASSERT_EQ(tokens.size(), 10); // 13 tokens en total
 
@@ -162,9 +173,9 @@ TEST(LexerTest, TokenizeStringOperations) {
 
 // Prueba de una función con comparación y retorno
 TEST(LexerTest, TokenizeFunctionWithComparison) {
-    std::string source = "func compare(int a, int b) -> bool { return a equal b or a less_than b }";
+    SourceBuffer source("func compare(int a, int b) -> bool { return a equal b or a less_than b }");
     Lexer lexer(source);
-    std::vector<Lexer::Token> tokens = lexer.tokenize();
+    TokenBuffer tokens = lexer.tokenize();
 
     ASSERT_EQ(tokens.size(), 22); // 21 tokens en total
 
@@ -176,6 +187,566 @@ TEST(LexerTest, TokenizeFunctionWithComparison) {
     EXPECT_EQ(tokens[18].type, TokenType::TOK_LESS);      // 'less_than'
 }
 
+// Los lexemas son vistas sobre el SourceBuffer, sin copias
+TEST(LexerTest, LexemesAreViewsIntoSourceBuffer) {
+    SourceBuffer buffer("string greeting = \"a fairly long literal that defeats SSO\"");
+    ErrorManager errorManager;
+    Lexer lexer(buffer, errorManager);
+    TokenBuffer tokens = lexer.tokenize();
+
+    ASSERT_EQ(tokens.size(), 5);
+    EXPECT_EQ(tokens[1].lexeme, "greeting");
+    EXPECT_EQ(tokens[3].lexeme, "a fairly long literal that defeats SSO");
+    for (const auto &token : tokens) {
+        if (token.type == TokenType::TOK_EOF)
+            continue;
+        EXPECT_GE(token.lexeme.data(), buffer.begin());
+        EXPECT_LE(token.lexeme.data() + token.lexeme.size(), buffer.end());
+    }
+    EXPECT_EQ(std::distance(tokens.begin(), tokens.end()), 5);
+    EXPECT_EQ((*std::next(tokens.begin(), 3)).lexeme, tokens[3].lexeme);
+}
+
+// Modo bajo demanda: peek(k) no consume, next() avanza
+TEST(LexerTest, PullModePeekAndNext) {
+    SourceBuffer source("int x = 10\nfloat y");
+    Lexer lexer(source);
+
+    EXPECT_EQ(lexer.peek().type, TokenType::TOK_INT);
+    EXPECT_EQ(lexer.peek(2).type, TokenType::TOK_ASSIGN);
+    EXPECT_EQ(lexer.peek(3).lexeme, "10");
+    EXPECT_THROW(lexer.peek(Lexer::MAX_LOOKAHEAD), std::out_of_range);
+
+    EXPECT_EQ(lexer.next().type, TokenType::TOK_INT);
+    EXPECT_EQ(lexer.next().lexeme, "x");
+    EXPECT_EQ(lexer.next().type, TokenType::TOK_ASSIGN);
+    EXPECT_EQ(lexer.peek().lexeme, "10");
+    EXPECT_EQ(lexer.peek(1).type, TokenType::TOK_NEWLINE);
+    EXPECT_EQ(lexer.next().type, TokenType::TOK_NUMBER);
+    EXPECT_EQ(lexer.next().type, TokenType::TOK_NEWLINE);
+    EXPECT_EQ(lexer.next().type, TokenType::TOK_FLOAT);
+    EXPECT_EQ(lexer.next().lexeme, "y");
+    EXPECT_EQ(lexer.next().type, TokenType::TOK_EOF);
+    EXPECT_EQ(lexer.next().type, TokenType::TOK_EOF);
+}
+
+// Clasificación de palabras clave sin tabla hash
+TEST(LexerTest, ClassifyKeywordsAndNearMisses) {
+    EXPECT_EQ(TokenManager::classifyIdentifier("int"), TokenType::TOK_INT);
+    EXPECT_EQ(TokenManager::classifyIdentifier("else"), TokenType::TOK_ELSE);
+    EXPECT_EQ(TokenManager::classifyIdentifier("times"), TokenType::TOK_TIMES);
+    EXPECT_EQ(TokenManager::classifyIdentifier("delete"), TokenType::TOK_DELETE);
+    EXPECT_EQ(TokenManager::classifyIdentifier("less_than"), TokenType::TOK_LESS);
+    EXPECT_EQ(TokenManager::classifyIdentifier("less_or_equal"), TokenType::TOK_LESS_EQ);
+
+    for (const char *ident : {"", "i", "in", "ints", "Int", "iF", "repeal", "retorn", "fun",
+                              "greater_then", "less_or_equals", "different_"}) {
+        EXPECT_EQ(TokenManager::classifyIdentifier(ident), TokenType::TOK_IDENTIFIER) << ident;
+    }
+}
+
+// Los núcleos SIMD deben coincidir con la versión escalar en cualquier posición
+TEST(LexerTest, CharScanKernelsMatchScalar) {
+    std::mt19937 rng(7);
+    const char alphabet[] = "abcXYZ_0189 \t\r\n\"'.-+*(){}";
+    std::uniform_int_distribution<int> pick(0, sizeof(alphabet) - 2);
+    std::string text(4096, ' ');
+    for (auto &c : text)
+        c = alphabet[pick(rng)];
+    // Rachas largas que cruzan varios bloques de 16/32 bytes
+    text.replace(100, 70, std::string(70, 'q'));
+    text.replace(300, 70, std::string(70, '7'));
+    text.replace(500, 70, std::string(70, ' '));
+
+    using Scan = const char *(*)(const char *, const char *);
+    const Scan scans[] = {charscan::skipIdentifierChars, charscan::skipDigits,
+                          charscan::skipBlanks};
+    const char *begin = text.data();
+    const char *end = text.data() + text.size();
+
+    charscan::Isa original = charscan::activeIsa();
+    std::vector<const char *> expected;
+    std::vector<size_t> expectedNewlines;
+    ASSERT_TRUE(charscan::setIsa(charscan::Isa::Scalar));
+    for (Scan scan : scans)
+        for (const char *p = begin; p < end; ++p)
+            expected.push_back(scan(p, end));
+    for (const char *p = begin; p < end; ++p)
+        expectedNewlines.push_back(charscan::countNewlines(p, end));
+
+    for (auto isa : {charscan::Isa::SSE2, charscan::Isa::AVX2}) {
+        if (!charscan::setIsa(isa))
+            continue;
+        size_t i = 0;
+        for (Scan scan : scans)
+            for (const char *p = begin; p < end; ++p)
+                ASSERT_EQ(scan(p, end), expected[i++]) << "offset " << (p - begin);
+        for (const char *p = begin; p < end; ++p)
+            ASSERT_EQ(charscan::countNewlines(p, end), expectedNewlines[p - begin]);
+    }
+    charscan::setIsa(original);
+}
+
+// Posición del primer byte inválido según el validador escalar de referencia
+TEST(LexerTest, Utf8ValidationRejectsMalformedSequences) {
+    struct Case {
+        std::string text;
+        size_t invalidAt; // npos = válido
+    };
+    const size_t valid = std::string::npos;
+    const Case cases[] = {
+        {"hola", valid},
+        {"canción ñandú", valid},
+        {"\xE6\xBC\xA2\xE5\xAD\x97", valid},        // 漢字
+        {"\xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF", valid}, // U+1F600, U+10FFFF
+        {"a\xC0\x80", 1},                               // overlong
+        {"ab\xE0\x80\x80", 2},                          // overlong de 3 bytes
+        {"\xED\xA0\x80", 0},                            // surrogate
+        {"x\xF4\x90\x80\x80", 1},                       // > U+10FFFF
+        {"\xF5\x80\x80\x80", 0},
+        {"abc\x80", 3},  // continuación suelta
+        {"abc\xC3", 3},  // cortado al final
+        {"\xE2\x82z", 0}, // cortado en medio
+    };
+    charscan::Isa original = charscan::activeIsa();
+    for (auto isa : {charscan::Isa::Scalar, charscan::Isa::SSE2, charscan::Isa::AVX2}) {
+        if (!charscan::setIsa(isa))
+            continue;
+        for (const Case &c : cases) {
+            // Con relleno ASCII para que el caso caiga en medio y al final de un bloque
+            for (size_t pad : {0, 30, 64}) {
+                std::string text = std::string(pad, 'x') + c.text;
+                const char *end = text.data() + text.size();
+                size_t expected = c.invalidAt == valid ? text.size() : pad + c.invalidAt;
+                EXPECT_EQ(charscan::findInvalidUtf8(text.data(), end) - text.data(), expected)
+                    << c.text << " pad " << pad << " isa " << int(isa);
+            }
+        }
+    }
+    charscan::setIsa(original);
+}
+
+// Texto aleatorio con secuencias de 1 a 4 bytes y algunas corrupciones
+TEST(LexerTest, Utf8KernelsMatchScalar) {
+    std::mt19937 rng(21);
+    const std::vector<std::string> pieces = {"a", " ", "\xC3\xB1", "\xE2\x82\xAC",
+                                             "\xF0\x9F\x98\x80", "\xE6\xBC\xA2"};
+    const std::vector<std::string> corruptions = {"\x80", "\xC3", "\xED\xA0\x80", "\xFF",
+                                                  "\xE0\x80"};
+    charscan::Isa original = charscan::activeIsa();
+    for (int round = 0; round < 200; ++round) {
+        std::string text;
+        size_t length = std::uniform_int_distribution<size_t>(0, 300)(rng);
+        while (text.size() < length) {
+            if (rng() % 200 == 0)
+                text += corruptions[rng() % corruptions.size()];
+            else if (rng() % 3 == 0)
+                text += std::string(rng() % 70, 'z'); // bloques ASCII completos
+            else
+                text += pieces[rng() % pieces.size()];
+        }
+        const char *begin = text.data();
+        const char *end = text.data() + text.size();
+
+        ASSERT_TRUE(charscan::setIsa(charscan::Isa::Scalar));
+        std::vector<const char *> expected;
+        for (const char *p = begin; p <= end; ++p)
+            expected.push_back(charscan::findInvalidUtf8(p, end));
+        for (auto isa : {charscan::Isa::SSE2, charscan::Isa::AVX2}) {
+            if (!charscan::setIsa(isa))
+                continue;
+            for (const char *p = begin; p <= end; ++p)
+                ASSERT_EQ(charscan::findInvalidUtf8(p, end), expected[p - begin])
+                    << "round " << round << " offset " << (p - begin) << " isa " << int(isa);
+        }
+    }
+    charscan::setIsa(original);
+}
+
+// Los literales admiten UTF-8; los bytes mal formados dan un único error
+TEST(LexerTest, Utf8StringLiterals) {
+    SourceBuffer source("string s = \"¡Hola, señor! 漢字 😀\"\nchar c = 'ñ'\n");
+    ErrorManager errors;
+    Lexer lexer(source, errors);
+    TokenBuffer tokens = lexer.tokenize();
+    EXPECT_FALSE(errors.hasErrors()) << errors.getErrorReport();
+    EXPECT_EQ(tokens.lexeme(3), "¡Hola, señor! 漢字 😀");
+    EXPECT_EQ(tokens.lexeme(8), "ñ");
+
+    SourceBuffer badSource("string s = \"ab\xC3(\"\nint ñ\n");
+    ErrorManager badErrors;
+    Lexer bad(badSource, badErrors);
+    TokenBuffer badTokens = bad.tokenize();
+    EXPECT_EQ(badTokens.kind(3), TokenType::TOK_STRING_LITERAL);
+    ASSERT_EQ(badErrors.getErrorCount(), 2);
+    std::string report = badErrors.getErrorReport();
+    EXPECT_NE(report.find("Invalid UTF-8 in string literal"), std::string::npos);
+    EXPECT_NE(report.find("Unexpected character: ñ"), std::string::npos);
+}
+
+// Línea y columna se calculan a partir del offset solo cuando se piden
+TEST(LexerTest, LineColumnResolvedFromOffsets) {
+    SourceBuffer buffer("int a = 1\n\n  string s = \"x\"\nfloat @");
+    ErrorManager errorManager;
+    Lexer lexer(buffer, errorManager);
+    TokenBuffer tokens = lexer.tokenize();
+
+    ASSERT_EQ(tokens.size(), 12); // las dos líneas en blanco dan un solo TOK_NEWLINE
+    EXPECT_EQ(tokens[5].lexeme, "string");
+    LineColumn position = buffer.getLineColumn(tokens[5].offset);
+    EXPECT_EQ(position.line, 3);
+    EXPECT_EQ(position.column, 3);
+    position = buffer.getLineColumn(tokens[11].offset); // EOF
+    EXPECT_EQ(position.line, 4);
+    EXPECT_EQ(position.column, 8);
+
+    ASSERT_EQ(errorManager.getErrorCount(), 1);
+    PresumedLoc presumed = errorManager.getPresumedLoc(*errorManager.getErrors()[0]);
+    EXPECT_EQ(presumed.line, 4);
+    EXPECT_EQ(presumed.column, 7);
+    EXPECT_NE(errorManager.getErrorReport().find("line 4, column 7"), std::string::npos);
+}
+
+// Almacenamiento en arrays paralelos: tipos en un array denso de bytes
+TEST(LexerTest, TokenBufferStoresParallelArrays) {
+    SourceBuffer source("char c = 'z'\nstring s = \"abc\"");
+    Lexer lexer(source);
+    TokenBuffer tokens = lexer.tokenize();
+
+    static_assert(sizeof(TokenType) == 1, "token kinds must pack into bytes");
+    ASSERT_EQ(tokens.size(), 10);
+    ASSERT_EQ(tokens.getKinds().size(), tokens.size());
+    EXPECT_EQ(tokens.kind(3), TokenType::TOK_CHAR_LITERAL);
+    EXPECT_EQ(tokens.lexeme(3), "z");
+    EXPECT_EQ(tokens.offset(3), 9u); // la comilla de apertura
+    EXPECT_EQ(tokens.kind(8), TokenType::TOK_STRING_LITERAL);
+    EXPECT_EQ(tokens.lexeme(8), "abc");
+    EXPECT_EQ(tokens[5].lexeme, "string");
+    EXPECT_EQ(tokens.kind(9), TokenType::TOK_EOF);
+    EXPECT_EQ(tokens.offset(9), source.size());
+}
+
+// Genera un programa con literales multilínea, líneas en blanco y errores
+std::string makeStressSource(unsigned seed, size_t lines) {
+    std::mt19937 rng(seed);
+    const std::vector<std::string> pieces = {
+        "int a = 10", "float f = 3.25", "string s = \"one\ntwo\n\nthree\"",
+        "char c = '\n'", "\n\n", "  \t ", "x -> y", "bool b = a less_than 2",
+        "@", "1.", "{ [ ( ) ] }", "string t = \"\"", "\"\n\"", "func f(int a) -> int"};
+    std::uniform_int_distribution<size_t> pick(0, pieces.size() - 1);
+    std::string source;
+    for (size_t i = 0; i < lines; ++i) {
+        source += pieces[pick(rng)];
+        source += (i % 3 == 0) ? " " : "\n";
+    }
+    return source;
+}
+
+void expectSameTokens(const TokenBuffer &serial, const TokenBuffer &parallel) {
+    ASSERT_EQ(serial.size(), parallel.size());
+    for (size_t i = 0; i < serial.size(); ++i) {
+        ASSERT_EQ(serial.kind(i), parallel.kind(i)) << "token " << i;
+        ASSERT_EQ(serial.offset(i), parallel.offset(i)) << "token " << i;
+        ASSERT_EQ(serial.lexeme(i), parallel.lexeme(i)) << "token " << i;
+    }
+}
+
+// El lexer paralelo debe producir exactamente la misma salida que el serie
+TEST(LexerTest, ParallelLexerMatchesSerial) {
+    for (unsigned seed = 0; seed < 8; ++seed) {
+        std::string text = makeStressSource(seed, 400);
+        if (seed % 2)
+            text += "string open = \"never closed\n\nint z = 1";
+        SourceBuffer buffer(text);
+
+        ErrorManager serialErrors;
+        Lexer lexer(buffer, serialErrors);
+        TokenBuffer serial = lexer.tokenize();
+
+        for (size_t chunkSize : {1, 7, 64, 500}) {
+            ErrorManager parallelErrors;
+            ParallelLexer parallel(buffer, parallelErrors, 4, chunkSize);
+            TokenBuffer tokens = parallel.tokenize();
+            SCOPED_TRACE("seed " + std::to_string(seed) + ", chunk " + std::to_string(chunkSize));
+            expectSameTokens(serial, tokens);
+            EXPECT_EQ(serialErrors.getErrorReport(), parallelErrors.getErrorReport());
+        }
+    }
+}
+
+// Relexar tras una edición debe dar lo mismo que tokenizar el texto nuevo
+TEST(LexerTest, RelexAfterEditMatchesFullTokenize) {
+    std::mt19937 rng(7);
+    const std::vector<std::string> inserts = {"",  "x",    "1",  ".5", "\"", "'", "\n",
+                                              " ", "->",   "-",  ">",  "@",  "int y = 2\n",
+                                              "\"a\nb\"", "\n\n", "return"};
+    std::string text = makeStressSource(3, 300);
+    auto buffer = std::make_unique<SourceBuffer>(text);
+    ErrorManager errors;
+    TokenBuffer tokens = Lexer(*buffer, errors).tokenize();
+
+    for (int step = 0; step < 300; ++step) {
+        uint32_t offset = std::uniform_int_distribution<uint32_t>(0, text.size())(rng);
+        uint32_t length = std::uniform_int_distribution<uint32_t>(
+            0, std::min<uint32_t>(12, text.size() - offset))(rng);
+        const std::string &insert =
+            inserts[std::uniform_int_distribution<size_t>(0, inserts.size() - 1)(rng)];
+
+        text.replace(offset, length, insert);
+        auto edited = std::make_unique<SourceBuffer>(text);
+        ErrorManager relexErrors;
+        Lexer(*edited, relexErrors).relex(tokens, TextEdit{offset, length, insert});
+        buffer = std::move(edited);
+
+        ErrorManager fullErrors;
+        TokenBuffer full = Lexer(*buffer, fullErrors).tokenize();
+        SCOPED_TRACE("step " + std::to_string(step));
+        EXPECT_EQ(&tokens.getSourceBuffer(), buffer.get());
+        expectSameTokens(full, tokens);
+    }
+}
+
+// Cada identificador se interna una sola vez: misma grafía, mismo símbolo
+TEST(LexerTest, IdentifiersAreInterned) {
+    SourceBuffer source("int count = total\ncount = totals\nif count");
+    Lexer lexer(source);
+    TokenBuffer tokens = lexer.tokenize();
+
+    Symbol count = tokens.symbol(1);
+    ASSERT_TRUE(count.isValid());
+    EXPECT_EQ(count.str(), "count");
+    EXPECT_EQ(tokens.symbol(5), count);
+    EXPECT_EQ(tokens.symbol(10), count);
+    EXPECT_NE(tokens.symbol(3), tokens.symbol(7)); // total / totals
+    EXPECT_EQ(SymbolTable::global().intern("total"), tokens.symbol(3));
+
+    // Las palabras clave y el resto de tokens no llevan símbolo
+    EXPECT_FALSE(tokens.symbol(0).isValid()); // int
+    EXPECT_FALSE(tokens.symbol(2).isValid()); // =
+    EXPECT_FALSE(tokens.symbol(9).isValid()); // if
+}
+
+// Varios hilos internando a la vez obtienen los mismos IDs
+TEST(LexerTest, SymbolTableIsThreadSafe) {
+    SymbolTable &table = SymbolTable::global();
+    std::vector<std::vector<Symbol>> results(4);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&table, &results, t] {
+            for (int i = 0; i < 2000; ++i)
+                results[t].push_back(table.intern("sym_" + std::to_string(i)));
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    for (size_t t = 1; t < results.size(); ++t)
+        EXPECT_EQ(results[0], results[t]);
+    EXPECT_EQ(results[0][42].str(), "sym_42");
+}
+
+// Los números se decodifican al escanearlos; el desbordamiento es un diagnóstico
+TEST(LexerTest, NumbersAreDecodedByTheLexer) {
+    SourceBuffer source("42 3.25 007 9223372036854775807 9223372036854775808 1.");
+    ErrorManager errors;
+    Lexer lexer(source, errors);
+    TokenBuffer tokens = lexer.tokenize();
+
+    ASSERT_EQ(tokens.size(), 7u);
+    EXPECT_EQ(tokens[0].value.integer, 42);
+    EXPECT_FALSE(tokens[0].isFloat());
+    EXPECT_TRUE(tokens[1].isFloat());
+    EXPECT_DOUBLE_EQ(tokens[1].value.real, 3.25);
+    EXPECT_EQ(tokens[2].value.integer, 7);
+    EXPECT_EQ(tokens[3].value.integer, INT64_MAX);
+    EXPECT_EQ(tokens[4].type, TokenType::TOK_NUMBER);
+    EXPECT_EQ(tokens[4].value.integer, 0);
+    EXPECT_EQ(tokens[5].value.integer, 1); // "1." se reporta, pero conserva el entero
+
+    ASSERT_TRUE(errors.hasErrors());
+    std::string report = errors.getErrorReport();
+    EXPECT_NE(report.find("Integer literal out of range: 9223372036854775808"), std::string::npos);
+    EXPECT_NE(report.find("Malformed number"), std::string::npos);
+}
+
+void expectSameValues(const TokenBuffer &expected, const TokenBuffer &actual) {
+    for (size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQ(expected.symbol(i), actual.symbol(i)) << "token " << i;
+        ASSERT_EQ(expected.flags(i), actual.flags(i)) << "token " << i;
+        if (expected.kind(i) == TokenType::TOK_NUMBER) {
+            ASSERT_EQ(expected.value(i).integer, actual.value(i).integer) << "token " << i;
+        }
+    }
+}
+
+// La caché .umbtok reproduce exactamente la salida del lexer
+TEST(LexerTest, TokenCacheRoundTrip) {
+    std::string text = makeStressSource(11, 300) + "\nint big = 123456789012 - 3.5\n";
+    SourceBuffer buffer(text);
+    ErrorManager errors;
+    TokenBuffer original = Lexer(buffer, errors).tokenize();
+
+    std::string data = TokenCache::serialize(original);
+    std::optional<TokenBuffer> decoded = TokenCache::deserialize(data, buffer);
+    ASSERT_TRUE(decoded.has_value());
+    expectSameTokens(original, *decoded);
+    expectSameValues(original, *decoded);
+    EXPECT_LT(data.size(), original.size() * 4); // más compacto que los arrays en memoria
+
+    // Fuente distinta (otro hash) o entrada truncada: fallo, nunca tokens erróneos
+    SourceBuffer edited(text + " ");
+    EXPECT_FALSE(TokenCache::deserialize(data, edited).has_value());
+    for (size_t cut : {size_t(0), size_t(5), data.size() / 2, data.size() - 1})
+        EXPECT_FALSE(TokenCache::deserialize(llvm::StringRef(data).take_front(cut), buffer));
+
+    // Un código de tipo de token desconocido también se rechaza
+    SourceBuffer empty("");
+    std::string eofOnly = TokenCache::serialize(Lexer(empty, errors).tokenize());
+    ASSERT_TRUE(TokenCache::deserialize(eofOnly, empty).has_value());
+    eofOnly[eofOnly.size() - 3] = 0x7f; // tipo, desplazamiento 0, longitud 0
+    EXPECT_FALSE(TokenCache::deserialize(eofOnly, empty).has_value());
+}
+
+TEST(LexerTest, TokenCacheStoresByContentHash) {
+    llvm::SmallString<128> directory;
+    ASSERT_FALSE(llvm::sys::fs::createUniqueDirectory("umbtok", directory));
+    TokenCache cache(std::string(directory.str()));
+
+    SourceBuffer buffer("int a = 1\nfloat b = 2.5\nstring s = \"x\"\n", "first.umbra");
+    ErrorManager errors;
+    TokenBuffer tokens = Lexer(buffer, errors).tokenize();
+    EXPECT_FALSE(cache.load(buffer).has_value());
+    ASSERT_TRUE(cache.store(tokens));
+
+    // Mismo contenido con otro nombre: acierto
+    SourceBuffer same(std::string(buffer.getText()), "second.umbra");
+    std::optional<TokenBuffer> hit = cache.load(same);
+    ASSERT_TRUE(hit.has_value());
+    EXPECT_EQ(&hit->getSourceBuffer(), &same);
+    expectSameTokens(tokens, *hit);
+    expectSameValues(tokens, *hit);
+
+    llvm::sys::fs::remove_directories(directory);
+}
+
+// Cada fichero ocupa su propio rango de SourceLocation de 32 bits
+TEST(LexerTest, SourceManagerDecodesLocationsAcrossFiles) {
+    SourceManager manager;
+    const SourceBuffer &first =
+        manager.addBuffer(std::make_unique<SourceBuffer>("int a = 1\n", "a.umbra"));
+    const SourceBuffer &second =
+        manager.addBuffer(std::make_unique<SourceBuffer>("int b = 2\nfloat @\n", "b.umbra"));
+    EXPECT_EQ(sizeof(SourceLocation), 4u);
+    EXPECT_EQ(manager.getNumBuffers(), 2u);
+
+    // Los rangos no se solapan, incluida la posición de fin de fichero
+    SourceLocation endOfFirst = first.getLocation(static_cast<uint32_t>(first.size()));
+    EXPECT_LT(endOfFirst, second.getStartLocation());
+    EXPECT_EQ(manager.getBuffer(endOfFirst), &first);
+    EXPECT_EQ(manager.getBuffer(second.getLocation(3)), &second);
+    EXPECT_EQ(manager.getBuffer(SourceLocation()), nullptr);
+
+    ErrorManager errorManager;
+    errorManager.setSourceManager(&manager);
+    Lexer(first, errorManager).tokenize();
+    TokenBuffer tokens = Lexer(second, errorManager).tokenize();
+    EXPECT_EQ(manager.getBuffer(tokens.location(1)), &second);
+
+    ASSERT_EQ(errorManager.getErrorCount(), 1);
+    PresumedLoc presumed = errorManager.getPresumedLoc(*errorManager.getErrors()[0]);
+    EXPECT_EQ(presumed.filename, "b.umbra");
+    EXPECT_EQ(presumed.line, 2);
+    EXPECT_EQ(presumed.column, 7);
+    EXPECT_NE(errorManager.getErrorReport().find("in b.umbra at line 2, column 7"),
+              std::string::npos);
+}
+
+// Las trazas solo se escriben para las categorías activadas
+TEST(LexerTest, TraceWritesEnabledCategories) {
+    std::string output;
+    llvm::raw_string_ostream sink(output);
+    trace::setSink(&sink);
+
+    SourceBuffer source("char c = 'a'\n");
+    ErrorManager errorManager;
+    Lexer(source, errorManager).tokenize();
+    trace::flush();
+    EXPECT_TRUE(output.empty());
+
+    trace::enable(trace::Lexer);
+    Lexer(source, errorManager).tokenize();
+    trace::enable(0);
+    trace::setSink(nullptr);
+
+#if UMBRA_ENABLE_TRACE
+    EXPECT_NE(output.find("[lexer] char literal 'a'\n"), std::string::npos);
+    EXPECT_NE(output.find("[lexer] TOK_NEWLINE @12 '\\n'\n"), std::string::npos);
+#else
+    EXPECT_TRUE(output.empty());
+#endif
+    EXPECT_EQ(trace::parseCategory("Parser"), trace::Parser);
+    EXPECT_EQ(trace::parseCategory("all"), trace::All);
+    EXPECT_EQ(trace::parseCategory("codegen"), 0u);
+}
+
+// El pipeline entrega los mismos tokens que tokenize(), en trozos pequeños
+TEST(LexerTest, TokenPipelineMatchesTokenize) {
+    std::string text;
+    for (int i = 0; i < 500; ++i)
+        text += "int x" + std::to_string(i) + " = " + std::to_string(i) + (i % 10 ? "\n" : " $\n");
+    SourceBuffer source(text);
+
+    ErrorManager serialErrors;
+    TokenBuffer expected = Lexer(source, serialErrors).tokenize();
+
+    ErrorManager errorManager;
+    Lexer lexer(source, errorManager);
+    std::vector<Token> tokens;
+    {
+        TokenPipeline pipeline(lexer, 7);
+        do {
+            // Informes concurrentes con los del hilo del lexer
+            errorManager.hasErrors();
+            tokens.push_back(pipeline.next());
+        } while (tokens.back().type != TokenType::TOK_EOF);
+        EXPECT_EQ(pipeline.next().type, TokenType::TOK_EOF);
+    }
+
+    ASSERT_EQ(tokens.size(), expected.size());
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        EXPECT_EQ(tokens[i].type, expected.kind(i)) << "token " << i;
+        EXPECT_EQ(tokens[i].offset, expected.offset(i)) << "token " << i;
+    }
+    EXPECT_EQ(errorManager.getErrorCount(), serialErrors.getErrorCount());
+}
+
+// Una excepción del hilo del lexer se relanza en el consumidor
+TEST(LexerTest, TokenPipelineRethrowsLexerFailure) {
+    SourceBuffer source(std::string(500, '$'));
+    ErrorManager errorManager;
+    Lexer lexer(source, errorManager);
+    TokenPipeline pipeline(lexer, 16);
+    EXPECT_THROW(
+        {
+            while (pipeline.next().type != TokenType::TOK_EOF) {
+            }
+        },
+        std::runtime_error);
+    EXPECT_THROW(pipeline.peek(), std::runtime_error);
+}
+
+// Un pipeline abandonado antes del final no bloquea su destructor
+TEST(LexerTest, TokenPipelineStopsWhenAbandoned) {
+    std::string text;
+    for (int i = 0; i < 20000; ++i)
+        text += "float f = 1.5\n";
+    SourceBuffer source(text);
+    ErrorManager errorManager;
+    Lexer lexer(source, errorManager);
+    TokenPipeline pipeline(lexer, 4);
+    EXPECT_EQ(pipeline.peek().type, TokenType::TOK_FLOAT);
+}
+
 } // namespace umbra
 
 } // namespace umbra
@@ -0,0 +1,432 @@
+#include "../src/ast/ASTDumper.h"
+#include "../src/ast/ASTSerialization.h"
+#include "../src/ast/FlatAST.h"
+#include "../src/ast/StructuralHash.h"
+#include "../src/ast/visitor/RecursiveASTVisitor.h"
+#include "../src/error/ErrorManager.h"
+#include "../src/lexer/Lexer.h"
+#include "../src/parser/Parser.h"
+#include <gtest/gtest.h>
+#include <llvm/Support/Casting.h>
+#include <llvm/Support/JSON.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Cuenta todas las reservas de memoria del proceso
+namespace {
+std::atomic<uint64_t> allocationCount{0};
+} // namespace
+
+void *operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace umbra {
+
+namespace umbra {
+
+// Cada línea produce exactamente dos nodos: la declaración y su expresión
+std::string makeDeclarations(int count) {
+    const char *lines[] = {"int counter = 42\n", "float ratio = 2.5\n",
+                           "string greeting = \"a string longer than the SSO buffer\"\n",
+                           "int [16] values\n"};
+    std::string text;
+    for (int i = 0; i < count; ++i)
+        text += lines[i % 4];
+    return text;
+}
+
+uint64_t parseAllocations(const TokenBuffer &tokens) {
+    ErrorManager errorManager;
+    Parser parser(tokens, errorManager);
+    uint64_t before = allocationCount.load();
+    ASTContext context;
+    parser.parse(context);
+    uint64_t allocations = allocationCount.load() - before;
+    EXPECT_FALSE(errorManager.hasErrors()) << errorManager.getErrorReport();
+    return allocations;
+}
+
+// Consumir tokens no reserva memoria y los nodos salen de la arena del
+// ASTContext: solo quedan sus bloques y el crecimiento del vector de sentencias
+TEST(ParserTest, TokenAccessDoesNotAllocate) {
+    const int lines = 4000;
+    SourceBuffer small(makeDeclarations(lines));
+    SourceBuffer large(makeDeclarations(2 * lines));
+    ErrorManager errorManager;
+    TokenBuffer smallTokens = Lexer(small, errorManager).tokenize();
+    TokenBuffer largeTokens = Lexer(large, errorManager).tokenize();
+
+    uint64_t extra = parseAllocations(largeTokens) - parseAllocations(smallTokens);
+    // 2 nodos por línea: con un malloc por nodo serían 8000
+    EXPECT_LT(extra, lines / 16u);
+}
+
+// Lo mismo leyendo los tokens bajo demanda del lexer
+TEST(ParserTest, PullModeTokenAccessDoesNotAllocate) {
+    const int lines = 4000;
+    auto allocationsFor = [](const SourceBuffer &source) {
+        ErrorManager errorManager;
+        Lexer lexer(source, errorManager);
+        Parser parser(lexer, errorManager);
+        uint64_t before = allocationCount.load();
+        ASTContext context;
+        parser.parse(context);
+        return allocationCount.load() - before;
+    };
+    SourceBuffer small(makeDeclarations(lines));
+    SourceBuffer large(makeDeclarations(2 * lines));
+
+    uint64_t extra = allocationsFor(large) - allocationsFor(small);
+    EXPECT_LT(extra, lines / 16u);
+}
+
+// Analiza `source` dentro de `context`; el árbol apunta al SourceBuffer
+ProgramNode *parseProgram(const SourceBuffer &source, ASTContext &context) {
+    ErrorManager errorManager;
+    TokenBuffer tokens = Lexer(source, errorManager).tokenize();
+    return Parser(tokens, errorManager).parse(context);
+}
+
+std::string dumpTree(ASTNode *node, ASTDumper::Format format = ASTDumper::Format::Text) {
+    std::string text;
+    llvm::raw_string_ostream os(text);
+    ASTDumper(os, format).dump(node);
+    return os.str();
+}
+
+// El árbol vive en el ASTContext y los hermanos quedan contiguos en memoria
+TEST(ParserTest, ASTContextOwnsTheTree) {
+    SourceBuffer source("int a = 1\nfloat b = 2.5\nstring c = \"x\"\n");
+    ASTContext context;
+    ProgramNode *program = parseProgram(source, context);
+
+    ASSERT_EQ(program->getStatements().size(), 3u);
+    auto *first = llvm::dyn_cast<st_VariableDeclNode>(program->getStatements()[0]);
+    auto *second = llvm::dyn_cast<st_VariableDeclNode>(program->getStatements()[1]);
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_EQ(first->getName().str(), "a");
+    auto *value = llvm::dyn_cast<ex_IntegerLiteralNode>(first->getInitializer());
+    ASSERT_NE(value, nullptr);
+    EXPECT_EQ(value->value, 1);
+
+    // Declaración y literal se crean seguidos en el mismo bloque
+    auto distance = reinterpret_cast<const char *>(second) - reinterpret_cast<const char *>(first);
+    EXPECT_GT(distance, 0);
+    EXPECT_LT(distance, 128);
+    EXPECT_GT(context.getBytesAllocated(), 0u);
+}
+
+// El AST plano conserva la estructura y los valores del árbol de punteros
+TEST(ParserTest, FlatASTMatchesPointerTree) {
+    SourceBuffer source("int a = 7\nfloat [4] b = 2.5\nstring c = \"hola\"\nint d = 3\n"
+                        "char e = 'x'\nint f = a\n");
+    ASTContext context;
+    ProgramNode *program = parseProgram(source, context);
+    FlatAST flat = FlatAST::build(*program, source);
+
+    using Id = FlatAST::NodeId;
+    ASSERT_EQ(flat.kind(flat.getRoot()), FlatKind::Program);
+    llvm::ArrayRef<Id> statements = flat.children(flat.getRoot());
+    ASSERT_EQ(statements.size(), 6u);
+    EXPECT_EQ(flat.size(), 14u);
+    for (Id id : statements)
+        EXPECT_EQ(flat.kind(id), FlatKind::VariableDecl);
+
+    EXPECT_EQ(flat.name(statements[0]).str(), "a");
+    EXPECT_EQ(flat.declType(statements[0]), TokenType::TOK_INT);
+    EXPECT_EQ(flat.integer(flat.initializer(statements[0])), 7);
+    EXPECT_EQ(flat.arraySize(statements[0]), FlatAST::NONE);
+
+    EXPECT_EQ(flat.real(flat.initializer(statements[1])), 2.5);
+    EXPECT_EQ(flat.integer(flat.arraySize(statements[1])), 4);
+    EXPECT_EQ(flat.text(flat.initializer(statements[2])), "hola");
+    EXPECT_EQ(flat.integer(flat.initializer(statements[3])), 3);
+    EXPECT_EQ(flat.text(flat.initializer(statements[4])), "x");
+    Id identifier = flat.initializer(statements[5]);
+    EXPECT_EQ(flat.kind(identifier), FlatKind::Identifier);
+    EXPECT_EQ(flat.name(identifier).str(), "a");
+
+    // Pre-orden: cada nodo precede a sus hijos
+    for (Id id : statements)
+        EXPECT_LT(id, flat.initializer(id));
+
+    FlatAST copy = flat;
+    EXPECT_TRUE(copy == flat);
+    EXPECT_TRUE(FlatAST::build(*program, source) == flat);
+}
+
+// isa/cast/dyn_cast usan la etiqueta de tipo, también para las clases base
+TEST(ParserTest, NodeKindsDriveCasting) {
+    ASTContext context;
+    ASTNode *integer = context.create<ex_IntegerLiteralNode>(3);
+    ASTNode *declaration =
+        context.create<st_VariableDeclNode>(TokenType::TOK_INT, Symbol(), nullptr, nullptr);
+    ASTNode *program = context.create<ProgramNode>(llvm::ArrayRef<ASTNode *>());
+
+    EXPECT_EQ(integer->getKind(), ASTNode::Kind::IntegerLiteral);
+    EXPECT_TRUE(llvm::isa<ExpressionNode>(integer));
+    EXPECT_FALSE(llvm::isa<StatementNode>(integer));
+    EXPECT_TRUE((llvm::isa<ex_FloatLiteralNode, ex_IntegerLiteralNode>(integer)));
+    EXPECT_EQ(llvm::cast<ex_IntegerLiteralNode>(integer)->value, 3);
+    EXPECT_EQ(llvm::dyn_cast<ex_FloatLiteralNode>(integer), nullptr);
+
+    EXPECT_TRUE(llvm::isa<StatementNode>(declaration));
+    EXPECT_FALSE(llvm::isa<ExpressionNode>(declaration));
+    EXPECT_NE(llvm::dyn_cast<st_VariableDeclNode>(declaration), nullptr);
+
+    EXPECT_FALSE((llvm::isa<StatementNode, ExpressionNode>(program)));
+    EXPECT_TRUE(llvm::isa<ProgramNode>(program));
+}
+
+// Visitante estático: recorre en orden de fuente y se puede detener
+class CollectingVisitor : public RecursiveASTVisitor<CollectingVisitor> {
+  public:
+    std::vector<ASTNode::Kind> kinds;
+    size_t limit = SIZE_MAX;
+    int64_t integerSum = 0;
+
+    bool visitNode(ASTNode *node) {
+        kinds.push_back(node->getKind());
+        return kinds.size() < limit;
+    }
+    bool visitIntegerLiteral(ex_IntegerLiteralNode *node) {
+        integerSum += node->value;
+        return true;
+    }
+};
+
+// Las redefiniciones de traverseExpression se respetan en todas las entradas
+class ExpressionCountingVisitor : public RecursiveASTVisitor<ExpressionCountingVisitor> {
+  public:
+    int expressions = 0;
+
+    bool traverseExpression(ExpressionNode *node) {
+        expressions += node != nullptr;
+        return true;
+    }
+};
+
+TEST(ParserTest, RecursiveASTVisitorTraversesInSourceOrder) {
+    SourceBuffer source("int [4] a = 7\nstring s = \"x\"\nint b = a\n");
+    ASTContext context;
+    ProgramNode *program = parseProgram(source, context);
+
+    using Kind = ASTNode::Kind;
+    CollectingVisitor visitor;
+    EXPECT_TRUE(visitor.traverse(program));
+    std::vector<Kind> expected = {Kind::Program,       Kind::VariableDecl,  Kind::IntegerLiteral,
+                                  Kind::IntegerLiteral, Kind::VariableDecl, Kind::StringLiteral,
+                                  Kind::VariableDecl,   Kind::Identifier};
+    EXPECT_EQ(visitor.kinds, expected);
+    EXPECT_EQ(visitor.integerSum, 11);
+
+    CollectingVisitor stopped;
+    stopped.limit = 3;
+    EXPECT_FALSE(stopped.traverse(program));
+    EXPECT_EQ(stopped.kinds.size(), 3u);
+    EXPECT_EQ(stopped.integerSum, 0);
+
+    ExpressionCountingVisitor counter;
+    EXPECT_TRUE(counter.traverse(program));
+    EXPECT_EQ(counter.expressions, 4);
+    EXPECT_TRUE(counter.traverse(context.getIntegerLiteral(1)));
+    EXPECT_EQ(counter.expressions, 5);
+}
+
+// Los tres formatos del volcado describen el mismo árbol
+TEST(ParserTest, ASTDumperWritesTextJSONAndDOT) {
+    SourceBuffer source("int [4] a = 7\nstring s = \"hé\"\nint b = a\n");
+    ASTContext context;
+    ProgramNode *program = parseProgram(source, context);
+
+    EXPECT_EQ(dumpTree(program), "Program\n"
+                                 "    VariableDeclaration int[] a\n"
+                                 "        arraySize: IntegerLiteral 4\n"
+                                 "        initializer: IntegerLiteral 7\n"
+                                 "    VariableDeclaration string s\n"
+                                 "        initializer: StringLiteral \"hé\"\n"
+                                 "    VariableDeclaration int b\n"
+                                 "        initializer: Identifier a\n");
+
+    llvm::Expected<llvm::json::Value> json =
+        llvm::json::parse(dumpTree(program, ASTDumper::Format::JSON));
+    ASSERT_TRUE(bool(json)) << llvm::toString(json.takeError());
+    const llvm::json::Object *root = json->getAsObject();
+    ASSERT_NE(root, nullptr);
+    EXPECT_EQ(root->getString("kind").getValueOr(""), "Program");
+    const llvm::json::Array *statements = root->getArray("statements");
+    ASSERT_NE(statements, nullptr);
+    ASSERT_EQ(statements->size(), 3u);
+    const llvm::json::Object *first = (*statements)[0].getAsObject();
+    EXPECT_EQ(first->getString("type").getValueOr(""), "int");
+    EXPECT_EQ(first->getString("name").getValueOr(""), "a");
+    EXPECT_EQ(first->getObject("arraySize")->getInteger("value").getValueOr(0), 4);
+    EXPECT_EQ(first->getObject("initializer")->getInteger("value").getValueOr(0), 7);
+    const llvm::json::Object *second = (*statements)[1].getAsObject();
+    EXPECT_EQ(second->getObject("initializer")->getString("value").getValueOr(""), "hé");
+    const llvm::json::Object *last = (*statements)[2].getAsObject();
+    EXPECT_EQ(last->getObject("initializer")->getString("name").getValueOr(""), "a");
+
+    std::string dot = dumpTree(program, ASTDumper::Format::DOT);
+    EXPECT_EQ(dot.rfind("digraph UmbraAST {\n    rankdir = LR;\n", 0), 0u);
+    EXPECT_NE(dot.find("    n0 [label = \"Program\";fillcolor = lightblue;];\n"),
+              std::string::npos);
+    EXPECT_NE(dot.find("    n5 [label = \"StringLiteral \\\"hé\\\"\";fillcolor = lightyellow;];\n"),
+              std::string::npos);
+    EXPECT_NE(dot.find("    n4 -> n5 [label = \"initializer\";];\n"), std::string::npos);
+    EXPECT_NE(dot.find("    n0 -> n6;\n"), std::string::npos);
+    EXPECT_EQ(dot.substr(dot.size() - 2), "}\n");
+}
+
+std::unique_ptr<llvm::MemoryBuffer> moduleBuffer(const std::string &data) {
+    return llvm::MemoryBuffer::getMemBufferCopy(data, "test.umbast");
+}
+
+// Un módulo .umbast reproduce el árbol y rechaza entradas truncadas
+TEST(ParserTest, ASTSerializationRoundTrips) {
+    SourceBuffer source("int [4] a = 7\nfloat f = 2.5\nstring s = \"x y\"\nint b = a\n");
+    ASTContext context;
+    ProgramNode *program = parseProgram(source, context);
+
+    std::string data = ASTWriter::serialize(*program, source);
+    ASTContext loadedContext;
+    std::unique_ptr<ASTReader> reader = ASTReader::create(moduleBuffer(data), loadedContext);
+    ASSERT_NE(reader, nullptr);
+    EXPECT_TRUE(reader->isFor(source));
+    EXPECT_FALSE(reader->isFor(SourceBuffer("int a = 7\n")));
+    EXPECT_EQ(dumpTree(reader->getProgram()), dumpTree(program));
+    EXPECT_EQ(ASTWriter::serialize(*reader->getProgram(), source), data);
+
+    for (size_t size = 0; size < data.size(); ++size) {
+        ASTContext truncatedContext;
+        EXPECT_EQ(ASTReader::create(moduleBuffer(data.substr(0, size)), truncatedContext),
+                  nullptr)
+            << "prefix of " << size << " bytes";
+    }
+}
+
+// Los cuerpos de las funciones se leen en el primer acceso
+TEST(ParserTest, ASTReaderLoadsFunctionBodiesLazily) {
+    SourceBuffer source("func f(int a) -> int { int x = a return x }\n");
+    SymbolTable &symbols = SymbolTable::global();
+    ASTContext context;
+    ParameterNode *parameter =
+        context.create<ParameterNode>(TokenType::TOK_INT, symbols.intern("a"));
+    ASTNode *local = context.create<st_VariableDeclNode>(
+        TokenType::TOK_INT, symbols.intern("x"),
+        context.create<ex_IdentifierNode>(symbols.intern("a")), nullptr);
+    auto *returnStmt = context.create<ReturnStatementNode>(
+        context.create<ex_IdentifierNode>(symbols.intern("x")));
+    ASTNode *function = context.create<FunctionDeclNode>(
+        symbols.intern("f"), context.copyArray<ParameterNode *>({parameter}), TokenType::TOK_INT,
+        context.copyArray<ASTNode *>({local}), returnStmt);
+    ProgramNode *program = context.create<ProgramNode>(context.copyArray<ASTNode *>({function}));
+
+    std::string data = ASTWriter::serialize(*program, source);
+    ASTContext loadedContext;
+    std::unique_ptr<ASTReader> reader = ASTReader::create(moduleBuffer(data), loadedContext);
+    ASSERT_NE(reader, nullptr);
+    auto *loaded = llvm::cast<FunctionDeclNode>(reader->getProgram()->getStatements()[0]);
+    EXPECT_FALSE(loaded->isBodyLoaded());
+    EXPECT_EQ(loaded->getName().str(), "f");
+    ASSERT_EQ(loaded->getParams().size(), 1u);
+    EXPECT_EQ(loaded->getParams()[0]->getName().str(), "a");
+    EXPECT_FALSE(loaded->isBodyLoaded());
+
+    ASSERT_EQ(loaded->getBody().size(), 1u);
+    EXPECT_TRUE(loaded->isBodyLoaded());
+    EXPECT_EQ(dumpTree(reader->getProgram()), dumpTree(program));
+
+    // El último byte es el símbolo del valor de retorno: fuera de rango
+    data.back() = 0x7f;
+    ASTContext corruptContext;
+    reader = ASTReader::create(moduleBuffer(data), corruptContext);
+    ASSERT_NE(reader, nullptr);
+    auto *corrupt = llvm::cast<FunctionDeclNode>(reader->getProgram()->getStatements()[0]);
+    EXPECT_THROW((void)corrupt->getBody(), std::runtime_error);
+}
+
+// Con uniquing, los literales y nombres iguales comparten un único nodo
+TEST(ParserTest, UniquingSharesEqualLeaves) {
+    SourceBuffer source("int a = 7\nint b = 7\nfloat f = 7.0\nint c = a\nint d = a\n");
+    auto initializer = [](ProgramNode *program, size_t index) {
+        return llvm::cast<st_VariableDeclNode>(program->getStatements()[index])->getInitializer();
+    };
+
+    ASTContext plainContext;
+    ProgramNode *plain = parseProgram(source, plainContext);
+    ASTContext sharedContext;
+    sharedContext.setUniquing(true);
+    ProgramNode *shared = parseProgram(source, sharedContext);
+
+    EXPECT_NE(initializer(plain, 0), initializer(plain, 1));
+    EXPECT_EQ(initializer(shared, 0), initializer(shared, 1));
+    EXPECT_NE(initializer(shared, 0), initializer(shared, 2));
+    EXPECT_EQ(initializer(shared, 3), initializer(shared, 4));
+    EXPECT_LT(sharedContext.getBytesAllocated(), plainContext.getBytesAllocated());
+    EXPECT_EQ(dumpTree(shared), dumpTree(plain));
+}
+
+// El hash estructural depende solo de la forma y los valores del árbol
+TEST(ParserTest, StructuralHashFollowsStructure) {
+    SourceBuffer source("int a = 7\nint b = 7\nint c = a\nint d = a\n");
+    ASTContext context;
+    ProgramNode *program = parseProgram(source, context);
+    ASTContext sharedContext;
+    sharedContext.setUniquing(true);
+    ProgramNode *shared = parseProgram(source, sharedContext);
+
+    llvm::ArrayRef<ASTNode *> statements = program->getStatements();
+    auto initializer = [&](size_t index) {
+        return llvm::cast<st_VariableDeclNode>(statements[index])->getInitializer();
+    };
+    EXPECT_EQ(structuralHash(initializer(0)), structuralHash(initializer(1)));
+    EXPECT_TRUE(structurallyEqual(initializer(0), initializer(1)));
+    EXPECT_NE(structuralHash(initializer(1)), structuralHash(initializer(2)));
+    EXPECT_FALSE(structurallyEqual(initializer(1), initializer(2)));
+    EXPECT_NE(structuralHash(statements[0]), structuralHash(statements[1]));
+    EXPECT_FALSE(structurallyEqual(statements[0], statements[1]));
+
+    EXPECT_EQ(structuralHash(program), structuralHash(shared));
+    EXPECT_TRUE(structurallyEqual(program, shared));
+
+    // Un hijo nulo también cuenta, y en su posición
+    auto declaration = [&](ExpressionNode *arraySize, ExpressionNode *value) {
+        return context.create<st_VariableDeclNode>(TokenType::TOK_INT,
+                                                   SymbolTable::global().intern("a"), value,
+                                                   arraySize);
+    };
+    ExpressionNode *four = context.getIntegerLiteral(4);
+    EXPECT_NE(structuralHash(declaration(four, initializer(0))),
+              structuralHash(declaration(nullptr, initializer(0))));
+    EXPECT_NE(structuralHash(declaration(four, nullptr)),
+              structuralHash(declaration(nullptr, four)));
+    EXPECT_FALSE(structurallyEqual(declaration(four, nullptr), declaration(nullptr, four)));
+
+    // Estable entre procesos, plataformas y compilaciones: sirve como clave de
+    // caché. Los valores fijan los códigos de ASTCodes.h, no el orden de los enums
+    ASTContext literalContext;
+    EXPECT_EQ(structuralHash(literalContext.getIntegerLiteral(7)), 0xb47c6304870b268bull);
+    EXPECT_EQ(structuralHash(statements[0]), 0x7a8bfea6be5cdf8cull); // int a = 7
+}
+
+} // namespace umbra
+
+} // namespace umbra